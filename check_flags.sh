@@ -0,0 +1,56 @@
+#!/bin/bash
+# Checks the modes whose output differs from the one of the homework tests:
+# every test handles an input with some flags and compares the output to
+# its own reference, the way check.sh does
+EXEC=tema2
+TIMEOUT_TIME=2
+
+TESTS=(bytes0 bytes1 bytes2 bytes3 bytes4)
+INPUTS=(in/bytes0.in in/test15.in in/test25.in in/test17.in in/test17.in)
+FLAGS=("--cache-bytes=8"
+       "--cache-bytes=16 --cache-policy=tinylfu"
+       "--cache-bytes=16 --cache-policy=arc"
+       "--cache-bytes=24 --cache-policy=clock"
+       "--cache-bytes=24 --cache-policy=2q")
+
+PASSED=0
+FAILED=0
+
+cd skel && make build && mv $EXEC ../
+make clean &> /dev/null && cd ../
+mkdir -p out
+
+for ((i=0;i<${#TESTS[@]};i++)); do
+    name=${TESTS[$i]}
+    out_path="out/$name.out"
+    ref_path="ref/$name.ref"
+
+    echo -n "Test: $name (${FLAGS[$i]}) ...................... "
+
+    # The flags are split into separate arguments on purpose
+    timeout $TIMEOUT_TIME ./$EXEC ${INPUTS[$i]} ${FLAGS[$i]} > $out_path
+    if [ "$?" != "0" ]; then
+        echo "FAILED [exit code or timeout]"
+        FAILED=$(($FAILED+1))
+        continue
+    fi
+
+    if diff -bB -i $ref_path $out_path > my_diff 2>&1; then
+        echo "PASS"
+        PASSED=$(($PASSED+1))
+    else
+        echo "FAILED"
+        echo "Diff result:"
+        tail -n 10 my_diff
+        FAILED=$(($FAILED+1))
+    fi
+    rm -f my_diff
+done
+
+echo ""
+echo "PASSED: $PASSED/${#TESTS[@]}"
+
+rm -rf out
+rm -f $EXEC
+
+[ "$FAILED" == "0" ]
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "arena.h"
+
+// Header of every slab; it keeps the blocks after it 16 bytes aligned
+typedef struct arena_slab_t {
+	struct arena_slab_t *next;
+	size_t size;
+} arena_slab_t;
+
+// Header of a buffer too big for the size classes, linked with the other
+// ones so it can be freed on its own; it keeps the buffer 16 bytes aligned
+typedef struct arena_large_t {
+	struct arena_large_t *prev, *next;
+} arena_large_t;
+
+static void pool_init(arena_pool_t *pool, unsigned int block_size)
+{
+	memset(pool, 0, sizeof(*pool));
+	pool->block_size = block_size;
+	pool->slab_blocks = ARENA_FIRST_SLAB_BLOCKS;
+}
+
+/*
+ * pool_grow() - Adds a new slab to the arena, to be carved by the pool.
+ */
+static void pool_grow(arena_t *arena, arena_pool_t *pool)
+{
+	size_t size = sizeof(arena_slab_t) +
+				  (size_t)pool->slab_blocks * pool->block_size;
+
+	arena_slab_t *slab = malloc(size);
+	DIE(!slab, "malloc slab");
+
+	// Link the slab to the ones of the arena
+	slab->next = arena->slabs;
+	slab->size = size;
+	arena->slabs = slab;
+	arena->slab_count++;
+	arena->slab_bytes += size;
+
+	pool->bump = (char *)(slab + 1);
+	pool->bump_end = (char *)slab + size;
+
+	// The next slab of the pool is twice as big
+	if ((size_t)pool->slab_blocks * 2 * pool->block_size <= ARENA_MAX_SLAB_SIZE)
+		pool->slab_blocks *= 2;
+}
+
+static void *pool_alloc(arena_t *arena, arena_pool_t *pool)
+{
+	void *block;
+
+	if (pool->free_list) {
+		// Reuse a freed block
+		block = pool->free_list;
+		pool->free_list = *(void **)block;
+	} else {
+		// Carve a new block from the last slab
+		if (pool->bump == pool->bump_end)
+			pool_grow(arena, pool);
+
+		block = pool->bump;
+		pool->bump += pool->block_size;
+		pool->carved++;
+	}
+
+	pool->used++;
+	return block;
+}
+
+static void pool_free(arena_pool_t *pool, void *block)
+{
+	// The freed block stores the link to the next free one
+	*(void **)block = pool->free_list;
+	pool->free_list = block;
+	pool->used--;
+}
+
+/*
+ * large_alloc() - Allocates a buffer too big for the size classes.
+ */
+static void *large_alloc(arena_t *arena, unsigned int size)
+{
+	arena_large_t *large = malloc(sizeof(*large) + size);
+	DIE(!large, "malloc large buffer");
+
+	// Link the buffer first in the list of the arena
+	large->prev = NULL;
+	large->next = arena->large;
+	if (large->next)
+		large->next->prev = large;
+	arena->large = large;
+
+	arena->large_count++;
+	arena->large_bytes += size;
+
+	return large + 1;
+}
+
+static void large_free(arena_t *arena, void *ptr, unsigned int size)
+{
+	arena_large_t *large = (arena_large_t *)ptr - 1;
+
+	if (large->prev)
+		large->prev->next = large->next;
+	else
+		arena->large = large->next;
+
+	if (large->next)
+		large->next->prev = large->prev;
+
+	arena->large_count--;
+	arena->large_bytes -= size;
+	free(large);
+}
+
+/*
+ * get_class() - Gets the index of the smallest size class fitting size bytes.
+ */
+static unsigned int get_class(unsigned int size)
+{
+	unsigned int class = 0;
+
+	for (unsigned int block = ARENA_MIN_BLOCK; block < size; block *= 2)
+		class++;
+
+	return class;
+}
+
+arena_t *arena_create(void)
+{
+	arena_t *arena = calloc(1, sizeof(*arena));
+	DIE(!arena, "calloc arena");
+
+	pool_init(&arena->nodes, sizeof(ll_node_t));
+	pool_init(&arena->infos, sizeof(info_t));
+
+	for (unsigned int i = 0; i < ARENA_CLASSES; i++)
+		pool_init(&arena->buffers[i], ARENA_MIN_BLOCK << i);
+
+	return arena;
+}
+
+void *arena_alloc(arena_t *arena, unsigned int size)
+{
+	if (!arena) {
+		void *ptr = malloc(size);
+		DIE(!ptr, "malloc buffer");
+		return ptr;
+	}
+
+	if (size > ARENA_MAX_BLOCK)
+		return large_alloc(arena, size);
+
+	return pool_alloc(arena, &arena->buffers[get_class(size)]);
+}
+
+void arena_free(arena_t *arena, void *ptr, unsigned int size)
+{
+	if (!ptr)
+		return;
+
+	if (!arena) {
+		free(ptr);
+		return;
+	}
+
+	if (size > ARENA_MAX_BLOCK) {
+		large_free(arena, ptr, size);
+		return;
+	}
+
+	pool_free(&arena->buffers[get_class(size)], ptr);
+}
+
+void *arena_memdup(arena_t *arena, const void *ptr, unsigned int size)
+{
+	void *copy = arena_alloc(arena, size);
+	memcpy(copy, ptr, size);
+
+	return copy;
+}
+
+ll_node_t *arena_alloc_node(arena_t *arena)
+{
+	if (!arena) {
+		ll_node_t *node = calloc(1, sizeof(*node));
+		DIE(!node, "calloc node");
+		return node;
+	}
+
+	ll_node_t *node = pool_alloc(arena, &arena->nodes);
+	memset(node, 0, sizeof(*node));
+
+	return node;
+}
+
+void arena_free_node(arena_t *arena, ll_node_t *node)
+{
+	if (!arena)
+		free(node);
+	else if (node)
+		pool_free(&arena->nodes, node);
+}
+
+info_t *arena_alloc_info(arena_t *arena)
+{
+	if (!arena) {
+		info_t *info = calloc(1, sizeof(*info));
+		DIE(!info, "calloc info");
+		return info;
+	}
+
+	info_t *info = pool_alloc(arena, &arena->infos);
+	memset(info, 0, sizeof(*info));
+
+	return info;
+}
+
+void arena_free_info(arena_t *arena, info_t *info)
+{
+	if (!arena)
+		free(info);
+	else if (info)
+		pool_free(&arena->infos, info);
+}
+
+static void pool_print_stats(arena_pool_t *pool, const char *name, FILE *out)
+{
+	// Skip the pools which were never used
+	if (!pool->carved)
+		return;
+
+	fprintf(out, "\t%-8s %5u B: %7u / %7u blocks in use (%5.1f%%)\n", name,
+			pool->block_size, pool->used, pool->carved,
+			100.0 * pool->used / pool->carved);
+}
+
+void arena_print_stats(arena_t *arena, FILE *out)
+{
+	if (!arena)
+		return;
+
+	fprintf(out, "\t%u slabs, %zu bytes\n", arena->slab_count,
+			arena->slab_bytes);
+
+	if (arena->large_count)
+		fprintf(out, "\t%u large buffers, %zu bytes\n", arena->large_count,
+				arena->large_bytes);
+
+	pool_print_stats(&arena->nodes, "nodes", out);
+	pool_print_stats(&arena->infos, "infos", out);
+
+	for (unsigned int i = 0; i < ARENA_CLASSES; i++)
+		pool_print_stats(&arena->buffers[i], "buffers", out);
+}
+
+void arena_destroy(arena_t **arena)
+{
+	if (!arena || !*arena)
+		return;
+
+	// Release every slab, without looking at the blocks inside
+	arena_slab_t *slab = (*arena)->slabs;
+	while (slab) {
+		arena_slab_t *next = slab->next;
+		free(slab);
+		slab = next;
+	}
+
+	arena_large_t *large = (*arena)->large;
+	while (large) {
+		arena_large_t *next = large->next;
+		free(large);
+		large = next;
+	}
+
+	free(*arena);
+	*arena = NULL;
+}
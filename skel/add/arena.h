@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "linked_list.h"
+
+// Size classes for the buffers: powers of two from 16 to 256 bytes, enough
+// for the skip list nodes, the cache entries and the keys of up to
+// DOC_NAME_LENGTH bytes; bigger buffers are allocated on their own
+#define ARENA_MIN_BLOCK 16
+#define ARENA_MAX_BLOCK 256
+#define ARENA_CLASSES 5
+
+// A pool starts with slabs of a few blocks and doubles them, up to this size
+#define ARENA_FIRST_SLAB_BLOCKS 4
+#define ARENA_MAX_SLAB_SIZE (64 * 1024)
+
+typedef struct arena_pool_t {
+	// Size of the blocks of the pool
+	unsigned int block_size;
+
+	// Blocks which were freed and can be reused
+	void *free_list;
+
+	// Unused part of the last slab of the pool
+	char *bump, *bump_end;
+
+	// Number of blocks of the next slab
+	unsigned int slab_blocks;
+
+	// Number of blocks in use and number of blocks carved from the slabs
+	unsigned int used;
+	unsigned int carved;
+} arena_pool_t;
+
+typedef struct arena_t {
+	// Fixed size pools for the nodes of the lists and their data
+	arena_pool_t nodes;
+	arena_pool_t infos;
+
+	// Pools for the keys, the skip list nodes and the cache entries
+	arena_pool_t buffers[ARENA_CLASSES];
+
+	// All the slabs of the arena, released together
+	void *slabs;
+	unsigned int slab_count;
+	size_t slab_bytes;
+
+	// Buffers bigger than ARENA_MAX_BLOCK (e.g. a long key), in use
+	void *large;
+	unsigned int large_count;
+	size_t large_bytes;
+} arena_t;
+
+/*
+ * arena_create() - Creates an empty arena.
+ */
+arena_t *arena_create(void);
+
+/*
+ * arena_alloc() - Allocates a buffer of the given size, from the pool of
+ * its size class, or on its own if it is bigger than ARENA_MAX_BLOCK.
+ *
+ * @brief All of the arena functions fall back to malloc/free when given a
+ * NULL arena, so the structures using them also work without an arena.
+ */
+void *arena_alloc(arena_t *arena, unsigned int size);
+
+/*
+ * arena_free() - Gives a buffer back to the arena.
+ *
+ * @param size: The size the buffer was allocated with.
+ */
+void arena_free(arena_t *arena, void *ptr, unsigned int size);
+
+/*
+ * arena_memdup() - Allocates a copy of size bytes from ptr.
+ */
+void *arena_memdup(arena_t *arena, const void *ptr, unsigned int size);
+
+ll_node_t *arena_alloc_node(arena_t *arena);
+
+void arena_free_node(arena_t *arena, ll_node_t *node);
+
+info_t *arena_alloc_info(arena_t *arena);
+
+void arena_free_info(arena_t *arena, info_t *info);
+
+/*
+ * arena_print_stats() - Prints the occupancy of every pool of the arena.
+ */
+void arena_print_stats(arena_t *arena, FILE *out);
+
+/*
+ * arena_destroy() - Releases all the slabs and large buffers of the arena
+ * at once, including the blocks still in use.
+ */
+void arena_destroy(arena_t **arena);
+
+#endif /* ARENA_H */
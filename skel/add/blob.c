@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "blob.h"
+
+#include <stddef.h>
+
+// Gets the blob a string handed out by the blob functions belongs to
+#define BLOB_OF(str) ((blob_t *)((char *)(str) - offsetof(blob_t, data)))
+
+char *blob_create(const char *src, unsigned int len)
+{
+	blob_t *blob = malloc(sizeof(*blob) + len + 1);
+	DIE(!blob, "malloc blob");
+
+	blob->refcount = 1;
+	blob->length = len;
+	memcpy(blob->data, src, len);
+	blob->data[len] = '\0';
+
+	return blob->data;
+}
+
+char *blob_append(char *str, const char *src, unsigned int len)
+{
+	blob_t *blob = BLOB_OF(str);
+	DIE(blob->refcount != 1, "append to a shared blob");
+
+	blob = realloc(blob, sizeof(*blob) + blob->length + len + 1);
+	DIE(!blob, "realloc blob");
+
+	memcpy(blob->data + blob->length, src, len);
+	blob->length += len;
+	blob->data[blob->length] = '\0';
+
+	return blob->data;
+}
+
+char *blob_get(char *str)
+{
+	if (str)
+		BLOB_OF(str)->refcount++;
+
+	return str;
+}
+
+void blob_put(void *str)
+{
+	if (!str)
+		return;
+
+	blob_t *blob = BLOB_OF(str);
+	if (!--blob->refcount)
+		free(blob);
+}
+
+unsigned int blob_length(const char *str)
+{
+	return BLOB_OF(str)->length;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef BLOB_H
+#define BLOB_H
+
+#include "../utils.h"
+
+// Immutable, reference counted string, shared by everyone reading it
+typedef struct blob_t {
+	// Number of owners of the blob; it is freed when the last one drops it
+	unsigned int refcount;
+
+	// Length of the string, without the terminating null byte
+	unsigned int length;
+
+	// The string itself, which is what the blob functions hand out
+	char data[];
+} blob_t;
+
+/*
+ * blob_create() - Creates a blob holding a copy of len bytes from src.
+ *
+ * @return char* - The (null terminated) string of the blob, with a single
+ * reference, owned by the caller.
+ */
+char *blob_create(const char *src, unsigned int len);
+
+/*
+ * blob_append() - Appends len bytes from src to a blob which is not shared.
+ *
+ * @return char* - The string of the blob, which may have been moved.
+ */
+char *blob_append(char *str, const char *src, unsigned int len);
+
+/*
+ * blob_get() - Takes a new reference to the blob of a string.
+ *
+ * @return char* - The same string.
+ */
+char *blob_get(char *str);
+
+/*
+ * blob_put() - Drops a reference to the blob of a string, freeing the blob
+ * if it was the last one. Does nothing for NULL.
+ */
+void blob_put(void *str);
+
+unsigned int blob_length(const char *str);
+
+#endif /* BLOB_H */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "cache_policy.h"
+
+static const cache_policy *policies[] = {
+	&policy_lru, &policy_clock, &policy_2q, &policy_arc, &policy_tinylfu,
+};
+
+const cache_policy *cache_policy_find(const char *name)
+{
+	for (unsigned int i = 0; i < sizeof(policies) / sizeof(*policies); i++)
+		if (!strcmp(policies[i]->name, name))
+			return policies[i];
+
+	return NULL;
+}
+
+ll_node_t *policy_lists_next(ll_list_t **lists, unsigned int count,
+							 ll_node_t *node)
+{
+	// The rest of the node's list, then the lists after it
+	unsigned int list = 0;
+	if (node) {
+		if (node->next)
+			return node->next;
+
+		list = ((cache_entry *)node->data)->list + 1;
+	}
+
+	for (; list < count; list++)
+		if (lists[list]->head)
+			return lists[list]->head;
+
+	return NULL;
+}
+
+ghost_list *ghost_create(unsigned int capacity, arena_t *arena)
+{
+	ghost_list *ghosts = malloc(sizeof(*ghosts));
+	DIE(!ghosts, "malloc ghost list");
+
+	ghosts->keys = ll_create(sizeof(char *));
+	ghosts->index = oht_create_index(capacity, hash_string);
+	ghosts->arena = arena;
+
+	return ghosts;
+}
+
+ll_node_t *ghost_find(ghost_list *ghosts, const char *key)
+{
+	return oht_get(ghosts->index, (void *)key);
+}
+
+void ghost_push(ghost_list *ghosts, const char *key)
+{
+	// The node owns its copy of the key, which the index references
+	ll_node_t *node = arena_alloc_node(ghosts->arena);
+	node->data = arena_memdup(ghosts->arena, key, strlen(key) + 1);
+	ll_link_node_end(ghosts->keys, node);
+
+	oht_put(ghosts->index, node->data, strlen(key) + 1, node, sizeof(node));
+}
+
+void ghost_remove(ghost_list *ghosts, ll_node_t *node)
+{
+	char *key = node->data;
+
+	oht_remove_entry(ghosts->index, key);
+	ll_remove_node(ghosts->keys, node);
+
+	arena_free(ghosts->arena, key, strlen(key) + 1);
+	arena_free_node(ghosts->arena, node);
+}
+
+void ghost_trim(ghost_list *ghosts, unsigned int limit)
+{
+	while (ghosts->keys->size > limit)
+		ghost_remove(ghosts, ghosts->keys->head);
+}
+
+void ghost_free(ghost_list *ghosts)
+{
+	if (!ghosts)
+		return;
+
+	// Without an arena, the keys and nodes are freed one by one; otherwise
+	// they are released with the arena
+	if (!ghosts->arena)
+		ghost_trim(ghosts, 0);
+
+	oht_free(ghosts->index);
+	free(ghosts->keys);
+	free(ghosts);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef CACHE_POLICY_H
+#define CACHE_POLICY_H
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "open_hashtable.h"
+#include "specific_linked_list.h"
+
+// The entry of a cache whose policy keeps more than the order of its
+// entries; the key-value pair comes first, so it can still be used as an
+// info_t
+typedef struct cache_entry {
+	info_t info;
+
+	// List of the policy the entry is in
+	unsigned int list;
+
+	// Whether the entry was used since the hand of CLOCK last passed it
+	bool referenced;
+} cache_entry;
+
+// A replacement policy of the cache. The cache keeps the index from the keys
+// to their nodes, the key-value pairs and the counters; the policy only
+// orders the nodes (ll_node_t, whose data is an info_t, or a cache_entry for
+// the policies which need one) and picks the ones to evict.
+typedef struct cache_policy {
+	// Name the policy is selected by
+	const char *name;
+
+	// Size of the data of the nodes
+	unsigned int entry_size;
+
+	// Creates the state of the policy, for a cache of the given capacity;
+	// the keys the policy remembers itself are allocated from the arena
+	void *(*create)(unsigned int capacity, arena_t *arena);
+
+	// Sizes the state for another capacity: with a byte budget, the number
+	// of key-value pairs which fit changes with their sizes. NULL for the
+	// policies which do not depend on the capacity.
+	void (*resize)(void *state, unsigned int capacity);
+
+	// A cached key was used (by a get or by a put updating its value)
+	void (*hit)(void *state, ll_node_t *node);
+
+	// A key which is not cached is about to be added
+	void (*admit)(void *state, const char *key);
+
+	// Unlinks and returns the node to evict to make room for the key given
+	// to the last admit (or for a cached key which grew); called as many
+	// times as the cache needs, while it still has nodes
+	ll_node_t *(*evict)(void *state);
+
+	// Links the node of the key given to the last admit; without an admit
+	// since the last insert, puts back a node taken out with remove, where
+	// it was (in the same list, before the node which followed it, or the
+	// next one left), as when a cached key grows and the cache evicts other
+	// keys for it
+	void (*insert)(void *state, ll_node_t *node);
+
+	// Unlinks the node of a key removed from the cache
+	void (*remove)(void *state, ll_node_t *node);
+
+	// Gets the node after the given one (the first one for NULL), from the
+	// first to the last one the policy would evict, roughly
+	ll_node_t *(*next)(void *state, ll_node_t *node);
+
+	// Frees the state, but not the nodes, which belong to the cache
+	void (*destroy)(void *state);
+} cache_policy;
+
+extern const cache_policy policy_lru;
+extern const cache_policy policy_clock;
+extern const cache_policy policy_2q;
+extern const cache_policy policy_arc;
+extern const cache_policy policy_tinylfu;
+
+/*
+ * cache_policy_find() - Gets a policy by its name: lru, clock, 2q, arc or
+ * tinylfu.
+ *
+ * @return const cache_policy* - The policy, or NULL for an unknown name.
+ */
+const cache_policy *cache_policy_find(const char *name);
+
+/*
+ * policy_lists_next() - Implements the next function of a policy keeping its
+ * nodes in several lists, whose entries (cache_entry) are tagged with the
+ * index of their list; the lists are walked in the order of their indices.
+ */
+ll_node_t *policy_lists_next(ll_list_t **lists, unsigned int count,
+							 ll_node_t *node);
+
+// The keys recently evicted from a cache, in the order they were evicted,
+// without their values; used by the policies which adapt to the keys coming
+// back after their eviction
+typedef struct ghost_list {
+	// Nodes whose data is a copy of the key, from the oldest to the newest
+	ll_list_t *keys;
+
+	// Index from every key to its node
+	open_hashtable_t *index;
+
+	arena_t *arena;
+} ghost_list;
+
+ghost_list *ghost_create(unsigned int capacity, arena_t *arena);
+
+/*
+ * ghost_find() - Gets the node of a key, or NULL if it is not remembered.
+ */
+ll_node_t *ghost_find(ghost_list *ghosts, const char *key);
+
+/*
+ * ghost_push() - Remembers a copy of a key as the newest one.
+ */
+void ghost_push(ghost_list *ghosts, const char *key);
+
+/*
+ * ghost_remove() - Forgets a key, given its node.
+ */
+void ghost_remove(ghost_list *ghosts, ll_node_t *node);
+
+/*
+ * ghost_trim() - Forgets the oldest keys, until at most limit are left.
+ */
+void ghost_trim(ghost_list *ghosts, unsigned int limit);
+
+void ghost_free(ghost_list *ghosts);
+
+#endif /* CACHE_POLICY_H */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include <time.h>
+
+#include "histogram.h"
+
+unsigned long hist_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/*
+ * bucket_of() - Gets the bucket of a value.
+ */
+static unsigned int bucket_of(unsigned long value)
+{
+	if (value < HIST_SUB_BUCKETS)
+		return value;
+
+	if (value >> HIST_MAX_BITS)
+		return HIST_BUCKETS - 1;
+
+	// The highest set bit picks the power of two, the HIST_SUB_BITS bits
+	// after it the bucket inside it
+	unsigned int bit = 63 - __builtin_clzl(value);
+	unsigned int shift = bit - HIST_SUB_BITS;
+
+	return (shift + 1) * HIST_SUB_BUCKETS +
+		   (value >> shift) - HIST_SUB_BUCKETS;
+}
+
+/*
+ * bucket_max() - Gets the largest value of a bucket.
+ */
+static unsigned long bucket_max(unsigned int bucket)
+{
+	if (bucket < HIST_SUB_BUCKETS)
+		return bucket;
+
+	unsigned int shift = bucket / HIST_SUB_BUCKETS - 1;
+	unsigned long top = HIST_SUB_BUCKETS + bucket % HIST_SUB_BUCKETS;
+
+	return ((top + 1) << shift) - 1;
+}
+
+void hist_record(histogram_t *h, unsigned long value)
+{
+	if (!h->count || value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+
+	h->count++;
+	h->sum += value;
+	h->buckets[bucket_of(value)]++;
+}
+
+void hist_merge(histogram_t *to, histogram_t *from)
+{
+	if (!from->count)
+		return;
+
+	if (!to->count || from->min < to->min)
+		to->min = from->min;
+	if (from->max > to->max)
+		to->max = from->max;
+
+	to->count += from->count;
+	to->sum += from->sum;
+	for (unsigned int i = 0; i < HIST_BUCKETS; i++)
+		to->buckets[i] += from->buckets[i];
+
+	memset(from, 0, sizeof(*from));
+}
+
+unsigned long hist_percentile(const histogram_t *h, double p)
+{
+	if (!h->count)
+		return 0;
+
+	// The nearest rank of the value, counted from 1: the smallest one with
+	// at least p% of the values at or below it, so the rounding goes up (but
+	// not for the error of p / 100, as in 99.9% of 1000 values)
+	double exact = p / 100 * h->count;
+	unsigned long rank = exact;
+	if (exact - rank > 1e-9)
+		rank++;
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+
+	unsigned long seen = 0;
+	for (unsigned int i = 0; i < HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+
+		if (seen >= rank) {
+			unsigned long value = bucket_max(i);
+			return value < h->max ? value : h->max;
+		}
+	}
+
+	return h->max;
+}
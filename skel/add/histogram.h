@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+
+#include "../utils.h"
+
+// Every power of two is split into 2^HIST_SUB_BITS buckets of equal width,
+// so a value is known to within 1/16 (6.25%) of itself, however big it is
+#define HIST_SUB_BITS 4
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+
+// Values from 2^HIST_MAX_BITS ns (over an hour) are counted as the largest
+#define HIST_MAX_BITS 42
+
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+// Log-linear histogram of durations, in the style of HdrHistogram: the
+// values below HIST_SUB_BUCKETS have a bucket each, and every power of two
+// above them has HIST_SUB_BUCKETS buckets
+typedef struct histogram_t {
+	// Number of values, their sum and the extreme ones, kept exactly
+	unsigned long count;
+	unsigned long sum;
+	unsigned long min, max;
+
+	unsigned long buckets[HIST_BUCKETS];
+} histogram_t;
+
+/*
+ * hist_now() - Gets the time of the monotonic clock, in ns.
+ */
+unsigned long hist_now(void);
+
+/*
+ * hist_record() - Adds a value to a histogram, in constant time: its bucket
+ * is found from the position of its highest set bit.
+ */
+void hist_record(histogram_t *h, unsigned long value);
+
+/*
+ * hist_merge() - Adds the values of a histogram to another one, then
+ * empties the first one.
+ */
+void hist_merge(histogram_t *to, histogram_t *from);
+
+/*
+ * hist_percentile() - Gets a percentile of the values of a histogram, by
+ * the nearest rank (the value at rank ceil(p / 100 * count)).
+ *
+ * @param p: The percentile, between 0 and 100.
+ *
+ * @return unsigned long - The largest value of the bucket the percentile
+ * falls in (so it is never underestimated), bounded by the maximum; 0 for
+ * an empty histogram.
+ */
+unsigned long hist_percentile(const histogram_t *h, double p);
+
+#endif /* HISTOGRAM_H */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "latency.h"
+
+static const char *op_names[LATENCY_OPS] = {
+	"get_hit", "get_miss", "get_fault", "edit_queued", "execute_queue",
+	"add_server", "remove_server",
+};
+
+latency_t *latency_create(unsigned int sample_every)
+{
+	latency_t *lat = calloc(1, sizeof(*lat));
+	DIE(!lat, "calloc latency");
+
+	// Any seed but 0 works
+	lat->sample_every = sample_every;
+	lat->rng = 0x9e3779b9;
+
+	return lat;
+}
+
+unsigned long latency_start(latency_t *lat)
+{
+	if (!lat)
+		return 0;
+
+	// Reading the clock twice costs more than most requests, so only the
+	// ones picked by the generator are timed
+	lat->rng ^= lat->rng << 13;
+	lat->rng ^= lat->rng >> 17;
+	lat->rng ^= lat->rng << 5;
+
+	return lat->rng & (lat->sample_every - 1) ? 0 : hist_now();
+}
+
+void latency_record(latency_t *lat, latency_op op, unsigned long start)
+{
+	if (!lat)
+		return;
+
+	lat->counts[op]++;
+	if (start)
+		hist_record(&lat->ops[op], hist_now() - start);
+}
+
+latency_op latency_outcome(request_type type, const response *res)
+{
+	if (type == EDIT_DOCUMENT)
+		return LATENCY_EDIT_QUEUED;
+
+	if (!res || res->log == RESPONSE_LOG_FAULT)
+		return LATENCY_GET_FAULT;
+
+	return res->log == RESPONSE_LOG_HIT ? LATENCY_GET_HIT : LATENCY_GET_MISS;
+}
+
+void latency_merge(latency_t *to, latency_t *from)
+{
+	for (unsigned int i = 0; i < LATENCY_OPS; i++) {
+		hist_merge(&to->ops[i], &from->ops[i]);
+
+		to->counts[i] += from->counts[i];
+		from->counts[i] = 0;
+	}
+}
+
+void latency_print(const latency_t *lat, FILE *out)
+{
+	fprintf(out, "%-14s %10s %10s %10s %10s %10s %10s %12s\n",
+			"Operation (ns)", "count", "timed", "mean", "p50", "p99", "p999",
+			"max");
+
+	for (unsigned int i = 0; i < LATENCY_OPS; i++) {
+		const histogram_t *h = &lat->ops[i];
+
+		fprintf(out, "%-14s %10lu %10lu %10lu %10lu %10lu %10lu %12lu\n",
+				op_names[i], lat->counts[i], h->count,
+				h->count ? h->sum / h->count : 0,
+				hist_percentile(h, 50), hist_percentile(h, 99),
+				hist_percentile(h, 99.9), h->max);
+	}
+}
+
+void latency_free(latency_t **lat)
+{
+	free(*lat);
+	*lat = NULL;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "histogram.h"
+#include "response.h"
+
+// The operations whose latencies are recorded; a forwarded request is
+// counted by its outcome, since a GET answered from the cache and one
+// executing a long task queue first have nothing in common
+typedef enum latency_op {
+	LATENCY_GET_HIT,
+	LATENCY_GET_MISS,
+	LATENCY_GET_FAULT,
+	LATENCY_EDIT_QUEUED,
+
+	// Executing a non-empty task queue, on its own
+	LATENCY_EXECUTE_QUEUE,
+
+	LATENCY_ADD_SERVER,
+	LATENCY_REMOVE_SERVER,
+
+	LATENCY_OPS
+} latency_op;
+
+// One in this many forwarded requests and task queue executions is timed by
+// default; the topology changes are all timed
+#define LATENCY_SAMPLE_DEFAULT 16
+
+// A histogram for every operation
+typedef struct latency_t {
+	// Latencies of the timed operations
+	histogram_t ops[LATENCY_OPS];
+
+	// Number of every operation, timed or not
+	unsigned long counts[LATENCY_OPS];
+
+	// One in sample_every operations (a power of two) is timed, picked by a
+	// xorshift generator, so a workload repeating itself every few requests
+	// cannot keep some of them from being timed
+	unsigned int sample_every;
+	unsigned int rng;
+} latency_t;
+
+/*
+ * latency_create() - Creates an empty set of histograms, timing one in
+ * sample_every operations (a power of two; 1 to time all of them).
+ */
+latency_t *latency_create(unsigned int sample_every);
+
+/*
+ * latency_start() - Starts timing an operation, if it is picked.
+ *
+ * @return unsigned long - The time it starts at, or 0 if it is not timed
+ * (or the latencies are not recorded, for NULL).
+ */
+unsigned long latency_start(latency_t *lat);
+
+/*
+ * latency_record() - Counts an operation, and records the time since start
+ * as its latency if it was timed (start is not 0); nothing for NULL.
+ */
+void latency_record(latency_t *lat, latency_op op, unsigned long start);
+
+/*
+ * latency_outcome() - Gets the operation a forwarded request counts as,
+ * from its type and its response (NULL for none).
+ */
+latency_op latency_outcome(request_type type, const response *res);
+
+/*
+ * latency_merge() - Adds the histograms of a set to another one, then
+ * empties the first one.
+ */
+void latency_merge(latency_t *to, latency_t *from);
+
+/*
+ * latency_print() - Prints the number of every operation and of the ones
+ * timed, with the mean, the 50th, 99th and 99.9th percentiles and the
+ * maximum of their latencies, in ns.
+ */
+void latency_print(const latency_t *lat, FILE *out);
+
+void latency_free(latency_t **lat);
+
+#endif /* LATENCY_H */
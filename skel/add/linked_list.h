@@ -37,7 +37,7 @@ ll_node_t *ll_add_nth_node_info(ll_list_t *list, unsigned int n,
 
 ll_node_t *ll_remove_nth_node(ll_list_t *list, unsigned int n);
 
-ll_node_t *move_node_to_end(ll_list_t *list, void *data);
+ll_node_t *ll_move_node_to_end(ll_list_t *list, ll_node_t *node);
 
 ll_node_t *ll_remove_node(ll_list_t *list, ll_node_t *node);
 
@@ -0,0 +1,497 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "open_hashtable.h"
+
+// Marks the slots of removed entries, so the probe sequences stay unbroken
+static char tombstone;
+#define OHT_TOMBSTONE ((void *)&tombstone)
+
+static void table_init(oht_table_t *table, unsigned int capacity)
+{
+	table->slots = calloc(capacity, sizeof(*table->slots));
+	DIE(!table->slots, "calloc slots");
+
+	table->capacity = capacity;
+	table->size = 0;
+	table->tombstones = 0;
+}
+
+/*
+ * table_find() - Probes a table for a key.
+ *
+ * @return oht_entry_t* - The entry of the key if it exists, otherwise NULL.
+ * In the latter case, free_slot is set to the slot where the key should be
+ * added (the first tombstone or the empty slot ending the probe sequence).
+ */
+static oht_entry_t *table_find(oht_table_t *table, void *key,
+							   unsigned int hash, unsigned int key_size,
+							   oht_entry_t **free_slot)
+{
+	unsigned int mask = table->capacity - 1;
+	oht_entry_t *tomb = NULL;
+
+	for (unsigned int i = hash & mask;; i = (i + 1) & mask) {
+		oht_entry_t *entry = &table->slots[i];
+
+		// An empty slot ends the probe sequence
+		if (!entry->key) {
+			if (free_slot)
+				*free_slot = tomb ? tomb : entry;
+			return NULL;
+		}
+
+		// Remember the first tombstone, to reuse it
+		if (entry->key == OHT_TOMBSTONE) {
+			if (!tomb)
+				tomb = entry;
+			continue;
+		}
+
+		// Only compare the keys if their hashes and sizes match
+		if (entry->hash == hash && entry->key_size == key_size &&
+			!memcmp(entry->key, key, key_size))
+			return entry;
+	}
+}
+
+/*
+ * table_insert() - Places an entry in a table known not to contain its key.
+ */
+static void table_insert(oht_table_t *table, oht_entry_t *src)
+{
+	unsigned int mask = table->capacity - 1;
+	unsigned int i = src->hash & mask;
+
+	while (table->slots[i].key && table->slots[i].key != OHT_TOMBSTONE)
+		i = (i + 1) & mask;
+
+	if (table->slots[i].key == OHT_TOMBSTONE)
+		table->tombstones--;
+
+	table->slots[i] = *src;
+	table->size++;
+}
+
+/*
+ * rehash_step() - Moves up to slots entries of the old table to the new one.
+ */
+static void rehash_step(open_hashtable_t *ht, unsigned int slots)
+{
+	if (!ht->rehashing)
+		return;
+
+	for (; slots && ht->rehash_idx < ht->old.capacity; slots--) {
+		oht_entry_t *entry = &ht->old.slots[ht->rehash_idx++];
+
+		if (!entry->key || entry->key == OHT_TOMBSTONE)
+			continue;
+
+		// Leave a tombstone behind, so the keys that were not moved yet can
+		// still be found in the old table
+		table_insert(&ht->table, entry);
+		entry->key = OHT_TOMBSTONE;
+		ht->old.size--;
+		ht->old.tombstones++;
+	}
+
+	// The old table was emptied
+	if (ht->rehash_idx == ht->old.capacity) {
+		free(ht->old.slots);
+		memset(&ht->old, 0, sizeof(ht->old));
+		ht->rehashing = false;
+	}
+}
+
+/*
+ * grow() - Starts moving the entries to a bigger table (or to a table of
+ * the same size, if most of the used slots are tombstones).
+ */
+static void grow(open_hashtable_t *ht)
+{
+	// Finish the previous rehash first, so there are only two tables
+	if (ht->rehashing)
+		rehash_step(ht, ht->old.capacity);
+
+	// The new table should be at most half full
+	unsigned int capacity = ht->table.capacity;
+	while ((ht->table.size + 1) * 2 > capacity)
+		capacity *= 2;
+
+	ht->old = ht->table;
+	table_init(&ht->table, capacity);
+	ht->rehash_idx = 0;
+	ht->rehashing = true;
+}
+
+/*
+ * lookup() - Finds the entry of a key in any of the tables.
+ */
+static oht_entry_t *lookup(open_hashtable_t *ht, void *key, unsigned int hash,
+						   unsigned int key_size, oht_entry_t **free_slot)
+{
+	oht_entry_t *entry = table_find(&ht->table, key, hash, key_size,
+									free_slot);
+
+	if (!entry && ht->rehashing)
+		entry = table_find(&ht->old, key, hash, key_size, NULL);
+
+	return entry;
+}
+
+open_hashtable_t *oht_create(unsigned int capacity,
+							 unsigned int (*hash_function)(void *),
+							 void (*free_value)(void *), arena_t *arena)
+{
+	if (!hash_function)
+		return NULL;
+
+	open_hashtable_t *ht = calloc(1, sizeof(*ht));
+	DIE(!ht, "calloc hashtable");
+
+	// Room for the expected entries without growing
+	unsigned int slots = OHT_MIN_CAPACITY;
+	while (slots * OHT_LOAD_NUM < capacity * OHT_LOAD_DEN)
+		slots *= 2;
+
+	table_init(&ht->table, slots);
+	ht->hash_function = hash_function;
+	ht->owns_entries = true;
+	ht->free_value = free_value ? free_value : free;
+	ht->arena = arena;
+
+	return ht;
+}
+
+open_hashtable_t *oht_create_index(unsigned int capacity,
+								   unsigned int (*hash_function)(void *))
+{
+	open_hashtable_t *ht = oht_create(capacity, hash_function, NULL, NULL);
+
+	if (ht)
+		ht->owns_entries = false;
+
+	return ht;
+}
+
+void oht_enable_order(open_hashtable_t *ht)
+{
+	if (!ht || ht->order || oht_get_size(ht))
+		return;
+
+	ht->order = sl_create(ht->owns_entries ? ht->arena : NULL);
+}
+
+int oht_has_key(open_hashtable_t *ht, void *key)
+{
+	if (!ht || !key)
+		return -1;
+
+	return lookup(ht, key, ht->hash_function(key), strlen(key) + 1,
+				  NULL) != NULL;
+}
+
+void *oht_get(open_hashtable_t *ht, void *key)
+{
+	if (!ht || !key)
+		return NULL;
+
+	rehash_step(ht, OHT_REHASH_STEP);
+
+	oht_entry_t *entry = lookup(ht, key, ht->hash_function(key),
+								strlen(key) + 1, NULL);
+
+	return entry ? entry->value : NULL;
+}
+
+/*
+ * put() - Adds or overwrites a key of the given hash.
+ *
+ * @param take: If the hashtable owns its entries, whether the key and the
+ * value are handed over or have to be copied. A handed over key is only
+ * kept if the key is added.
+ */
+static int put(open_hashtable_t *ht, void *key, unsigned int key_size,
+			   unsigned int hash, void *value, unsigned int value_size,
+			   bool take)
+{
+	if (!value)
+		return -1;
+
+	rehash_step(ht, OHT_REHASH_STEP);
+
+	oht_entry_t *free_slot;
+	oht_entry_t *entry = lookup(ht, key, hash, key_size, &free_slot);
+
+	// The values of a hashtable owning its entries are copied with malloc,
+	// unless they are handed over by the caller
+	if (ht->owns_entries && !take)
+		value = arena_memdup(NULL, value, value_size);
+
+	// Overwrite the value of an existing key
+	if (entry) {
+		if (ht->owns_entries)
+			ht->free_value(entry->value);
+		ht->value_bytes = ht->value_bytes - entry->value_size + value_size;
+		entry->value = value;
+		entry->value_size = value_size;
+		return 0;
+	}
+
+	// Grow the table if adding the key would load it too much; the free
+	// slot has to be searched again, in the new table
+	oht_table_t *table = &ht->table;
+	if ((table->size + table->tombstones + 1) * OHT_LOAD_DEN >
+		table->capacity * OHT_LOAD_NUM) {
+		grow(ht);
+		table_find(table, key, hash, key_size, &free_slot);
+	}
+
+	if (free_slot->key == OHT_TOMBSTONE)
+		table->tombstones--;
+
+	free_slot->hash = hash;
+	free_slot->key_size = key_size;
+	free_slot->value = value;
+	free_slot->value_size = value_size;
+	table->size++;
+	ht->value_bytes += value_size;
+
+	// Indexes only reference the key, like the hashtables it is given to
+	free_slot->key = ht->owns_entries && !take ?
+					 arena_memdup(NULL, key, key_size) : key;
+
+	if (ht->order)
+		sl_insert(ht->order, hash, free_slot->key);
+
+	return 1;
+}
+
+int oht_put(open_hashtable_t *ht, void *key, unsigned int key_size,
+			void *value, unsigned int value_size)
+{
+	if (!ht || !key)
+		return -1;
+
+	return put(ht, key, key_size, ht->hash_function(key), value, value_size,
+			   false);
+}
+
+int oht_put_owned(open_hashtable_t *ht, void *key, unsigned int key_size,
+				  void *value, unsigned int value_size)
+{
+	if (!ht || !key)
+		return -1;
+
+	return put(ht, key, key_size, ht->hash_function(key), value, value_size,
+			   true);
+}
+
+/*
+ * find_entry() - Finds the entry of a key and the table it is in, without
+ * rehashing, so removing entries while iterating is safe.
+ */
+static oht_entry_t *find_entry(open_hashtable_t *ht, void *key,
+							   unsigned int hash, oht_table_t **table)
+{
+	unsigned int key_size = strlen(key) + 1;
+
+	*table = &ht->table;
+	oht_entry_t *entry = table_find(*table, key, hash, key_size, NULL);
+	if (!entry && ht->rehashing) {
+		*table = &ht->old;
+		entry = table_find(*table, key, hash, key_size, NULL);
+	}
+
+	return entry;
+}
+
+/*
+ * erase() - Removes the entry of a table, freeing its key and value only if
+ * they are not taken.
+ *
+ * @return void* - The value of the entry, if it is taken, otherwise NULL.
+ */
+static void *erase(open_hashtable_t *ht, oht_table_t *table,
+				   oht_entry_t *entry, bool take_key, bool take_value)
+{
+	void *value = take_value ? entry->value : NULL;
+
+	if (ht->order)
+		sl_remove(ht->order, entry->hash, entry->key);
+
+	if (ht->owns_entries) {
+		if (!take_key)
+			free(entry->key);
+		if (!take_value)
+			ht->free_value(entry->value);
+	}
+
+	entry->key = OHT_TOMBSTONE;
+	entry->value = NULL;
+	ht->value_bytes -= entry->value_size;
+
+	table->size--;
+	table->tombstones++;
+
+	return value;
+}
+
+/*
+ * remove_entry() - Removes a key, freeing its value only if it is not taken.
+ *
+ * @return void* - The value of the key, if it is taken, otherwise NULL.
+ */
+static void *remove_entry(open_hashtable_t *ht, void *key, bool take_value)
+{
+	if (!ht || !key)
+		return NULL;
+
+	oht_table_t *table;
+	oht_entry_t *entry = find_entry(ht, key, ht->hash_function(key), &table);
+	if (!entry)
+		return NULL;
+
+	return erase(ht, table, entry, false, take_value);
+}
+
+void oht_remove_entry(open_hashtable_t *ht, void *key)
+{
+	remove_entry(ht, key, false);
+}
+
+void *oht_detach_entry(open_hashtable_t *ht, void *key)
+{
+	return remove_entry(ht, key, true);
+}
+
+int oht_move_key(open_hashtable_t *from, open_hashtable_t *to, void *key)
+{
+	if (!from || !to || from == to || !key)
+		return -1;
+
+	// The key is hashed once, if both hashtables use the same function
+	unsigned int hash = from->hash_function(key);
+	unsigned int to_hash = to->hash_function == from->hash_function ?
+						   hash : to->hash_function(key);
+
+	oht_table_t *table;
+	oht_entry_t *entry = find_entry(from, key, hash, &table);
+	if (!entry)
+		return 0;
+
+	// Hand the key and the value over, then remove the entry without
+	// freeing them; the key is only freed if the second hashtable has it
+	if (!put(to, entry->key, entry->key_size, to_hash, entry->value,
+			 entry->value_size, true))
+		free(entry->key);
+	erase(from, table, entry, true, true);
+
+	return 1;
+}
+
+void oht_move_all(open_hashtable_t *from,
+				  open_hashtable_t *(*get_dest)(unsigned int, void *),
+				  void *ctx)
+{
+	if (!from)
+		return;
+
+	// Gather all the entries in a single table
+	if (from->rehashing)
+		rehash_step(from, from->old.capacity);
+
+	// The order is emptied at once, instead of one key at a time
+	if (from->order)
+		sl_clear(from->order);
+
+	oht_table_t *table = &from->table;
+	for (unsigned int i = 0; i < table->capacity; i++) {
+		oht_entry_t *entry = &table->slots[i];
+
+		if (entry->key && entry->key != OHT_TOMBSTONE) {
+			// Hand the entry over, reusing its hash; the destinations should
+			// not have the key already, but if one does, it keeps its own
+			open_hashtable_t *to = get_dest(entry->hash, ctx);
+			if (!put(to, entry->key, entry->key_size, entry->hash,
+					 entry->value, entry->value_size, true))
+				free(entry->key);
+		}
+	}
+
+	// All the slots are empty now
+	memset(table->slots, 0, table->capacity * sizeof(*table->slots));
+	table->size = 0;
+	table->tombstones = 0;
+	from->value_bytes = 0;
+}
+
+oht_entry_t *oht_next(open_hashtable_t *ht, unsigned int *pos)
+{
+	if (!ht)
+		return NULL;
+
+	// Gather all the entries in a single table
+	if (!*pos && ht->rehashing)
+		rehash_step(ht, ht->old.capacity);
+
+	for (; *pos < ht->table.capacity; (*pos)++) {
+		oht_entry_t *entry = &ht->table.slots[*pos];
+
+		if (entry->key && entry->key != OHT_TOMBSTONE) {
+			(*pos)++;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+unsigned int oht_get_size(open_hashtable_t *ht)
+{
+	if (!ht)
+		return 0;
+
+	return ht->table.size + ht->old.size;
+}
+
+unsigned long oht_get_bytes(open_hashtable_t *ht)
+{
+	if (!ht)
+		return 0;
+
+	return ht->value_bytes;
+}
+
+static void table_free(oht_table_t *table, bool free_keys,
+					   void (*free_value)(void *))
+{
+	for (unsigned int i = 0; (free_keys || free_value) &&
+		 i < table->capacity; i++) {
+		if (table->slots[i].key && table->slots[i].key != OHT_TOMBSTONE) {
+			if (free_keys)
+				free(table->slots[i].key);
+			if (free_value)
+				free_value(table->slots[i].value);
+		}
+	}
+
+	free(table->slots);
+}
+
+void oht_free(open_hashtable_t *ht)
+{
+	if (!ht)
+		return;
+
+	bool free_keys = ht->owns_entries;
+	void (*free_value)(void *) = ht->owns_entries ? ht->free_value : NULL;
+
+	table_free(&ht->table, free_keys, free_value);
+	if (ht->rehashing)
+		table_free(&ht->old, free_keys, free_value);
+
+	sl_free(&ht->order);
+	free(ht);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef OPEN_HASHTABLE_H
+#define OPEN_HASHTABLE_H
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "skiplist.h"
+#include "../utils.h"
+
+// Initial number of slots of a table (always a power of two)
+#define OHT_MIN_CAPACITY 16
+
+// The table is grown when more than 3/4 of its slots are used
+#define OHT_LOAD_NUM 3
+#define OHT_LOAD_DEN 4
+
+// Number of slots of the old table moved by each put or get while rehashing
+#define OHT_REHASH_STEP 64
+
+typedef struct oht_entry_t {
+	// Cached hash of the key
+	unsigned int hash;
+
+	// Size of the key, including the terminating null byte
+	unsigned int key_size;
+
+	// NULL for empty slots, OHT_TOMBSTONE for removed entries
+	void *key;
+	void *value;
+
+	// Size of the value
+	unsigned int value_size;
+} oht_entry_t;
+
+typedef struct oht_table_t {
+	oht_entry_t *slots;
+
+	// Number of slots (power of two)
+	unsigned int capacity;
+
+	// Number of live entries and of removed entries
+	unsigned int size;
+	unsigned int tombstones;
+} oht_table_t;
+
+typedef struct open_hashtable_t {
+	// The table new entries are added to
+	oht_table_t table;
+
+	// The table being emptied into the first one while rehashing
+	oht_table_t old;
+
+	// Next slot of the old table to be moved; only valid while rehashing
+	unsigned int rehash_idx;
+	bool rehashing;
+
+	// False for indexes, whose keys and values are owned by the caller
+	bool owns_entries;
+
+	// Allocator for the nodes of the order; NULL to use malloc. The keys and
+	// values never come from it, so they can be handed to other hashtables
+	arena_t *arena;
+
+	// Total size of the values of the live entries, as given to put
+	unsigned long value_bytes;
+
+	// Releases the values of a hashtable owning its entries
+	void (*free_value)(void *);
+
+	// The keys sorted by their hashes; NULL unless enabled
+	skiplist_t *order;
+
+	unsigned int (*hash_function)(void *);
+} open_hashtable_t;
+
+/*
+ * oht_create() - Creates an open addressing hashtable for string keys.
+ *
+ * @param capacity: Expected number of entries; the table grows past it.
+ * @param hash_function: Hash function for the keys.
+ * @param free_value: Releases a value which is removed or overwritten, or
+ * NULL to use free (the copies made by oht_put are malloc'ed).
+ * @param arena: Allocator for the nodes of the order (see oht_enable_order),
+ * or NULL to use malloc. The keys are always malloc'ed.
+ *
+ * @return open_hashtable_t* - The new hashtable.
+ */
+open_hashtable_t *oht_create(unsigned int capacity,
+							 unsigned int (*hash_function)(void *),
+							 void (*free_value)(void *), arena_t *arena);
+
+/*
+ * oht_create_index() - Creates an open addressing hashtable which only
+ * references its keys and values.
+ *
+ * @brief The keys and values given to oht_put are stored as they are,
+ * without being copied, and they are not freed when their entries are
+ * removed; they must outlive their entries.
+ */
+open_hashtable_t *oht_create_index(unsigned int capacity,
+								   unsigned int (*hash_function)(void *));
+
+/*
+ * oht_enable_order() - Makes an empty hashtable also keep its keys sorted by
+ * their hashes, in ht->order, so the keys whose hashes are in a range can
+ * be found without going through all of them.
+ */
+void oht_enable_order(open_hashtable_t *ht);
+
+/*
+ * oht_has_key() - Checks if a key is in the hashtable.
+ *
+ * @return int - 1 if the key exists, 0 otherwise, -1 on invalid arguments.
+ */
+int oht_has_key(open_hashtable_t *ht, void *key);
+
+/*
+ * oht_get() - Gets the value of a key, in a single probe of the table.
+ *
+ * @return void* - The value, or NULL if the key does not exist.
+ */
+void *oht_get(open_hashtable_t *ht, void *key);
+
+/*
+ * oht_put() - Adds a copy of the key-value pair or overwrites the value
+ * of an existing key.
+ *
+ * @return int - 1 if the key was added, 0 if it already existed.
+ *
+ * @brief Grows the hashtable when it gets too loaded; the entries are then
+ * moved to the new table a few slots at a time, by the following puts and
+ * gets, so a single put never has to move the whole table.
+ */
+int oht_put(open_hashtable_t *ht, void *key, unsigned int key_size,
+			void *value, unsigned int value_size);
+
+/*
+ * oht_put_owned() - Same as oht_put, but the hashtable takes ownership of the
+ * key and the value instead of copying them.
+ *
+ * @param key: A malloc'ed key, kept (and freed) by the hashtable only if it
+ * is added; otherwise it is left to the caller.
+ * @param value: A value released by the hashtable (with its free_value
+ * function) from now on.
+ */
+int oht_put_owned(open_hashtable_t *ht, void *key, unsigned int key_size,
+				  void *value, unsigned int value_size);
+
+/*
+ * oht_remove_entry() - Removes a key and frees its key and value.
+ */
+void oht_remove_entry(open_hashtable_t *ht, void *key);
+
+/*
+ * oht_detach_entry() - Removes a key, but gives its value to the caller
+ * instead of freeing it.
+ *
+ * @return void* - The value, owned by the caller, or NULL if the key does
+ * not exist.
+ */
+void *oht_detach_entry(open_hashtable_t *ht, void *key);
+
+/*
+ * oht_move_key() - Moves a key and its value (without copying the value) to
+ * another hashtable, which owns its entries too.
+ *
+ * @return int - 1 if the key was moved, 0 if it does not exist.
+ *
+ * @brief The key is hashed only once when both hashtables use the same hash
+ * function, and neither the key nor the value is copied. Like removing, it
+ * is safe while iterating over the first one.
+ */
+int oht_move_key(open_hashtable_t *from, open_hashtable_t *to, void *key);
+
+/*
+ * oht_move_all() - Moves all the entries of a hashtable to the hashtables
+ * chosen for their hashes, leaving the first one empty.
+ *
+ * @param get_dest: Gets the hashtable an entry should be moved to, from the
+ * hash of its key; all of them should use the same hash function as the
+ * first hashtable.
+ * @param ctx: Passed to get_dest.
+ *
+ * @brief The keys and values are handed over as they are, and the cached
+ * hashes are reused, so no key is hashed, copied or freed.
+ */
+void oht_move_all(open_hashtable_t *from,
+				  open_hashtable_t *(*get_dest)(unsigned int, void *),
+				  void *ctx);
+
+/*
+ * oht_next() - Iterates through the entries of the hashtable.
+ *
+ * @param pos: Position of the iterator, which should start at 0.
+ *
+ * @return oht_entry_t* - The next entry, or NULL after the last one.
+ *
+ * @brief Entries may be removed while iterating, but not added. The first
+ * call finishes any rehashing left, so all entries are in one table.
+ */
+oht_entry_t *oht_next(open_hashtable_t *ht, unsigned int *pos);
+
+unsigned int oht_get_size(open_hashtable_t *ht);
+
+/*
+ * oht_get_bytes() - Gets the total size of the values, without going
+ * through the entries.
+ */
+unsigned long oht_get_bytes(open_hashtable_t *ht);
+
+void oht_free(open_hashtable_t *ht);
+
+#endif /* OPEN_HASHTABLE_H */
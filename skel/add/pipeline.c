@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+#include "pipeline.h"
+#include "spsc.h"
+
+// A request passed from the parse stage to the route stage
+typedef struct pipeline_request {
+	// The request as it was read, with its precomputed hash, if any
+	parsed_request parsed;
+
+	// The request for the server; the strings of an EDIT are copies owned
+	// by it
+	request req;
+
+	// Whether there are no requests left
+	bool end;
+
+	// The call which failed in the parse stage, ending the requests, and
+	// its errno; NULL if none
+	const char *failed;
+	int error;
+} pipeline_request;
+
+// The memory of a writer, holding packed responses
+typedef struct pipeline_batch {
+	char *memory;
+	size_t length;
+	size_t capacity;
+
+	// Whether there are no batches left
+	bool end;
+} pipeline_batch;
+
+typedef struct pipeline_t {
+	load_balancer *main;
+	reader_t *input;
+	int requests_num;
+
+	// Parsed requests, batches of responses to be printed and batches
+	// printed, to be filled again
+	spsc_t *requests;
+	spsc_t *batches;
+	spsc_t *free_batches;
+
+	// Writer the route stage packs the responses with
+	writer_t *out;
+
+	// The call which failed in the parse or route stage, and its errno,
+	// reported by pipeline_run once the other stages ended; NULL if none
+	const char *failed;
+	int error;
+
+	// Time each stage spent working and waiting for the others
+	double busy_ns[PIPELINE_STAGES];
+	double idle_ns[PIPELINE_STAGES];
+} pipeline_t;
+
+static const char *stage_names[PIPELINE_STAGES] = {"parse", "route", "emit"};
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * push_timed() - Pushes an element, counting the time waited for a free
+ * slot as idle time of the stage.
+ */
+static void push_timed(pipeline_t *p, pipeline_stage stage, spsc_t *q,
+					   const void *data)
+{
+	if (spsc_try_push(q, data))
+		return;
+
+	double start = now_ns();
+	spsc_push(q, data);
+	p->idle_ns[stage] += now_ns() - start;
+}
+
+/*
+ * pop_timed() - Pops an element, counting the time waited for it as idle
+ * time of the stage.
+ */
+static void pop_timed(pipeline_t *p, pipeline_stage stage, spsc_t *q,
+					  void *data)
+{
+	if (spsc_try_pop(q, data))
+		return;
+
+	double start = now_ns();
+	spsc_pop(q, data);
+	p->idle_ns[stage] += now_ns() - start;
+}
+
+/*
+ * parse_stage() - Reads the requests and copies the strings of the EDITs,
+ * which are kept by the servers.
+ */
+static void *parse_stage(void *arg)
+{
+	pipeline_t *p = arg;
+	double start = now_ns();
+	pipeline_request end = { .end = true };
+
+	// The emit stage owns the standard output
+	writer_flush_on_exit(false);
+
+	for (int i = 0; i < p->requests_num; i++) {
+		pipeline_request item = { .end = false };
+		if (!reader_next(p->input, &item.parsed)) {
+			end.failed = "insufficient requests";
+			end.error = errno;
+			break;
+		}
+
+		item.req.type = item.parsed.type;
+		if (item.parsed.type == GET_DOCUMENT) {
+			// A GET only reads its name, straight from the input file
+			item.req.doc_name = item.parsed.doc_name;
+		} else if (item.parsed.type == EDIT_DOCUMENT) {
+			item.req.doc_name = strndup(item.parsed.doc_name,
+										item.parsed.doc_name_length);
+			if (!item.req.doc_name) {
+				end.failed = "strndup failed";
+				end.error = errno;
+				break;
+			}
+
+			item.req.doc_content = blob_create(item.parsed.doc_content,
+											   item.parsed.doc_content_length);
+		}
+
+		push_timed(p, PIPELINE_PARSE, p->requests, &item);
+	}
+
+	// A failure ends the requests early; the route stage reports it
+	push_timed(p, PIPELINE_PARSE, p->requests, &end);
+
+	p->busy_ns[PIPELINE_PARSE] =
+		now_ns() - start - p->idle_ns[PIPELINE_PARSE];
+
+	return NULL;
+}
+
+/*
+ * emit_stage() - Prints the packed responses of the batches, in order.
+ */
+static void *emit_stage(void *arg)
+{
+	pipeline_t *p = arg;
+	double start = now_ns();
+	pipeline_batch batch;
+	response res;
+
+	// A failure while printing loses the buffered output
+	writer_flush_on_exit(false);
+
+	while (true) {
+		pop_timed(p, PIPELINE_EMIT, p->batches, &batch);
+		if (batch.end)
+			break;
+
+		for (size_t pos = 0; pos < batch.length;) {
+			pos += response_unpack(batch.memory + pos, &res);
+			response_write(writer_stdout(), &res);
+		}
+
+		// Give the memory back to the route stage
+		batch.length = 0;
+		push_timed(p, PIPELINE_EMIT, p->free_batches, &batch);
+	}
+
+	writer_flush(writer_stdout());
+
+	p->busy_ns[PIPELINE_EMIT] = now_ns() - start - p->idle_ns[PIPELINE_EMIT];
+
+	return NULL;
+}
+
+/*
+ * pass_batch() - Passes the packed responses to the emit stage and starts
+ * a new batch.
+ */
+static void pass_batch(pipeline_t *p)
+{
+	writer_flush(p->out);
+
+	pipeline_batch batch = {
+		.memory = p->out->memory,
+		.length = p->out->memory_length,
+		.capacity = p->out->memory_capacity,
+		.end = false,
+	};
+	push_timed(p, PIPELINE_ROUTE, p->batches, &batch);
+
+	// Continue in the memory of a printed batch
+	pop_timed(p, PIPELINE_ROUTE, p->free_batches, &batch);
+	p->out->memory = batch.memory;
+	p->out->memory_length = 0;
+	p->out->memory_capacity = batch.capacity;
+}
+
+/*
+ * route_stage() - Forwards the requests to the servers, the way main does,
+ * and packs their responses.
+ */
+static void route_stage(pipeline_t *p)
+{
+	load_balancer *main = p->main;
+	double start = now_ns();
+	pipeline_request item;
+
+	while (true) {
+		pop_timed(p, PIPELINE_ROUTE, p->requests, &item);
+		if (item.end) {
+			if (!p->failed) {
+				p->failed = item.failed;
+				p->error = item.error;
+			}
+			break;
+		}
+
+		if (p->failed) {
+			// Drop the requests after a failure, until the parse stage ends
+			if (item.req.type == EDIT_DOCUMENT) {
+				free(item.req.doc_name);
+				blob_put(item.req.doc_content);
+			}
+		} else if (item.parsed.type == ADD_SERVER) {
+			if (item.parsed.cache_size < 0) {
+				p->failed = "cache size must be positive";
+				p->error = errno;
+				continue;
+			}
+
+			loader_add_server(main, item.parsed.server_id,
+							  item.parsed.cache_size);
+		} else if (item.parsed.type == REMOVE_SERVER) {
+			loader_remove_server(main, item.parsed.server_id);
+		} else if (item.parsed.type == GET_STATS) {
+			// The report is packed like the responses
+			loader_handle_stats(main);
+		} else {
+			// Forward the request by the hash of its name, if a trace
+			// stored it
+			response *res = item.parsed.hashed ?
+				loader_forward_hashed(main, &item.req, item.parsed.doc_hash) :
+				loader_forward_request(main, &item.req);
+
+			if (res)
+				main->print(main->out, res);
+
+			// A queued EDIT took its strings, which were cleared here
+			if (item.req.type == EDIT_DOCUMENT) {
+				free(item.req.doc_name);
+				blob_put(item.req.doc_content);
+			}
+		}
+
+		if (p->out->length + p->out->memory_length >= PIPELINE_BATCH_SIZE)
+			pass_batch(p);
+	}
+
+	// Pass the last responses, then end the emit stage
+	pass_batch(p);
+
+	pipeline_batch end = { .end = true };
+	push_timed(p, PIPELINE_ROUTE, p->batches, &end);
+
+	p->busy_ns[PIPELINE_ROUTE] =
+		now_ns() - start - p->idle_ns[PIPELINE_ROUTE];
+}
+
+/*
+ * print_stats() - Prints the busy and idle time of every stage.
+ */
+static void print_stats(pipeline_t *p, FILE *out)
+{
+	for (int i = 0; i < PIPELINE_STAGES; i++) {
+		double total = p->busy_ns[i] + p->idle_ns[i];
+
+		fprintf(out, "Stage %s: busy %.2f ms, idle %.2f ms (%.1f%% busy)\n",
+				stage_names[i], p->busy_ns[i] / 1e6, p->idle_ns[i] / 1e6,
+				total ? 100.0 * p->busy_ns[i] / total : 0.0);
+	}
+}
+
+void pipeline_run(load_balancer *main, reader_t *input, int requests_num,
+				  FILE *stats)
+{
+	pipeline_t p = {
+		.main = main,
+		.input = input,
+		.requests_num = requests_num,
+	};
+
+	p.requests = spsc_create(sizeof(pipeline_request),
+							 PIPELINE_QUEUE_CAPACITY);
+	p.batches = spsc_create(sizeof(pipeline_batch), PIPELINE_BATCHES);
+	p.free_batches = spsc_create(sizeof(pipeline_batch), PIPELINE_BATCHES);
+
+	// The route stage fills one batch, the others start empty
+	for (int i = 1; i < PIPELINE_BATCHES; i++) {
+		pipeline_batch batch = { .memory = NULL };
+		spsc_push(p.free_batches, &batch);
+	}
+
+	// The load balancer and its servers pack their responses
+	p.out = writer_memory();
+	loader_set_output(main, p.out, response_pack);
+
+	pthread_t parse_thread, emit_thread;
+	errno = pthread_create(&parse_thread, NULL, parse_stage, &p);
+	DIE(errno, "pthread_create");
+	errno = pthread_create(&emit_thread, NULL, emit_stage, &p);
+	DIE(errno, "pthread_create");
+
+	// The emit stage owns the standard output until it ends
+	writer_flush_on_exit(false);
+	route_stage(&p);
+
+	pthread_join(parse_thread, NULL);
+	pthread_join(emit_thread, NULL);
+	writer_flush_on_exit(true);
+
+	// Report a failure now that the responses before it are printed
+	errno = p.error;
+	DIE(p.failed, p.failed);
+
+	if (stats)
+		print_stats(&p, stats);
+
+	// Free the memory of the printed batches, then the one of the writer
+	pipeline_batch batch;
+	while (spsc_try_pop(p.free_batches, &batch))
+		free(batch.memory);
+
+	// Nothing is printed to the pipeline any more, including by the
+	// servers added while it ran
+	loader_set_output(main, writer_stdout(), response_write);
+
+	writer_close(&p.out);
+	spsc_free(&p.requests);
+	spsc_free(&p.batches);
+	spsc_free(&p.free_batches);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "reader.h"
+#include "../load_balancer.h"
+
+// Number of parsed requests which can wait for the route stage
+#define PIPELINE_QUEUE_CAPACITY 1024
+
+// Number of batches of responses passed between the route and emit stages
+// (and back, to be reused), and the size after which a batch is passed on
+#define PIPELINE_BATCHES 8
+#define PIPELINE_BATCH_SIZE (32 * 1024)
+
+// The stages of the pipeline
+typedef enum pipeline_stage {
+	PIPELINE_PARSE,
+	PIPELINE_ROUTE,
+	PIPELINE_EMIT,
+	PIPELINE_STAGES
+} pipeline_stage;
+
+/*
+ * pipeline_run() - Handles the requests of an input file in three stages,
+ * each on its own thread: parsing the requests, routing and executing them
+ * on the servers (on the calling thread) and printing their responses.
+ *
+ * @param main: The load balancer, without shards; it and its servers print
+ *        to the standard output again afterwards.
+ * @param input: The reader of the input file, whose header was read.
+ * @param requests_num: The number of requests of the input file.
+ * @param stats: File where the busy and idle time of every stage is
+ *        reported, or NULL.
+ *
+ * @brief The stages are connected by lock-free rings, so the requests and
+ * their responses keep their order. The responses are packed, with copies
+ * of their strings, by the route stage and only formatted by the emit one.
+ * An invalid input ends the requests early; it is reported through DIE on
+ * the calling thread, once the responses before it are printed. A failed
+ * allocation in the parse or emit stage ends the program from that stage
+ * and loses the buffered output. On the calling thread it loses it too,
+ * since the emit stage may be printing at the same time.
+ */
+void pipeline_run(load_balancer *main, reader_t *input, int requests_num,
+				  FILE *stats);
+
+#endif /* PIPELINE_H */
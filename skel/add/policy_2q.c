@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// 2Q (Johnson and Shasha, the full version): a new key enters A1in, a FIFO
+// of a quarter of the capacity, where its hits do not count, since they are
+// usually correlated (e.g. a GET right after an EDIT). The keys evicted from
+// A1in are remembered in A1out, for half of the capacity; a key coming back
+// while it is remembered was used again long after its first use, so it
+// enters Am, the LRU of the hot keys. A scan only goes through A1in.
+
+#include "cache_policy.h"
+
+// The lists of the entries, in the order they are walked
+enum { TWOQ_A1IN, TWOQ_AM, TWOQ_LISTS };
+
+typedef struct twoq_state {
+	ll_list_t *lists[TWOQ_LISTS];
+	ghost_list *a1out;
+
+	// Sizes A1in is allowed to grow past and A1out is kept to
+	unsigned int kin, kout;
+
+	// List the key given to the last admit enters, and whether there was
+	// an admit since the last insert
+	unsigned int incoming;
+	bool admitted;
+
+	// The node taken out by remove, until it is put back (NULL if none),
+	// and the node of its list it goes back before (NULL for the end)
+	ll_node_t *taken;
+	ll_node_t *taken_next;
+} twoq_state;
+
+/*
+ * twoq_size() - Sets the sizes of A1in and A1out from the capacity.
+ */
+static void twoq_size(twoq_state *q, unsigned int capacity)
+{
+	q->kin = capacity / 4 ? capacity / 4 : 1;
+	q->kout = capacity / 2 ? capacity / 2 : 1;
+}
+
+static void *twoq_create(unsigned int capacity, arena_t *arena)
+{
+	twoq_state *q = malloc(sizeof(*q));
+	DIE(!q, "malloc 2q");
+
+	for (unsigned int i = 0; i < TWOQ_LISTS; i++)
+		q->lists[i] = ll_create(sizeof(cache_entry));
+
+	twoq_size(q, capacity);
+	q->a1out = ghost_create(q->kout, arena);
+	q->incoming = TWOQ_A1IN;
+	q->admitted = false;
+	q->taken = NULL;
+
+	return q;
+}
+
+static void twoq_resize(void *state, unsigned int capacity)
+{
+	twoq_state *q = state;
+
+	// A1in shrinks as its keys are evicted, A1out right away
+	twoq_size(q, capacity);
+	ghost_trim(q->a1out, q->kout);
+}
+
+static void twoq_hit(void *state, ll_node_t *node)
+{
+	twoq_state *q = state;
+
+	if (((cache_entry *)node->data)->list == TWOQ_AM)
+		ll_move_node_to_end(q->lists[TWOQ_AM], node);
+}
+
+static void twoq_admit(void *state, const char *key)
+{
+	twoq_state *q = state;
+
+	// A remembered key goes straight to Am
+	ll_node_t *ghost = ghost_find(q->a1out, key);
+	q->incoming = ghost ? TWOQ_AM : TWOQ_A1IN;
+	q->admitted = true;
+	q->taken = NULL;
+	if (ghost)
+		ghost_remove(q->a1out, ghost);
+}
+
+static ll_node_t *twoq_evict(void *state)
+{
+	twoq_state *q = state;
+
+	// Evict from A1in while it is over its size (or Am is empty), and
+	// remember the key; otherwise evict the least recently used hot key
+	ll_list_t *a1in = q->lists[TWOQ_A1IN];
+	ll_node_t *victim;
+	if (a1in->size > q->kin || !q->lists[TWOQ_AM]->size) {
+		victim = ll_remove_node(a1in, a1in->head);
+
+		ghost_push(q->a1out, ((info_t *)victim->data)->key);
+		ghost_trim(q->a1out, q->kout);
+	} else {
+		victim = ll_remove_node(q->lists[TWOQ_AM], q->lists[TWOQ_AM]->head);
+	}
+
+	// The node taken out goes back before the one after the victim
+	if (q->taken && victim == q->taken_next)
+		q->taken_next = victim->next;
+
+	return victim;
+}
+
+static void twoq_insert(void *state, ll_node_t *node)
+{
+	twoq_state *q = state;
+	cache_entry *entry = node->data;
+
+	if (q->admitted) {
+		entry->list = q->incoming;
+		q->admitted = false;
+		ll_link_node_end(q->lists[entry->list], node);
+		return;
+	}
+
+	// A node put back returns to its place in its list, which matters in
+	// A1in, where the hits do not move the nodes
+	ll_link_node_before(q->lists[entry->list], node, q->taken_next);
+	q->taken = NULL;
+}
+
+static void twoq_remove(void *state, ll_node_t *node)
+{
+	twoq_state *q = state;
+
+	// Remember the node after it, in case it is put back
+	q->taken = node;
+	q->taken_next = node->next;
+
+	ll_remove_node(q->lists[((cache_entry *)node->data)->list], node);
+}
+
+static ll_node_t *twoq_next(void *state, ll_node_t *node)
+{
+	return policy_lists_next(((twoq_state *)state)->lists, TWOQ_LISTS, node);
+}
+
+static void twoq_destroy(void *state)
+{
+	twoq_state *q = state;
+
+	for (unsigned int i = 0; i < TWOQ_LISTS; i++)
+		free(q->lists[i]);
+	ghost_free(q->a1out);
+	free(q);
+}
+
+const cache_policy policy_2q = {
+	.name = "2q",
+	.entry_size = sizeof(cache_entry),
+	.create = twoq_create,
+	.resize = twoq_resize,
+	.hit = twoq_hit,
+	.admit = twoq_admit,
+	.evict = twoq_evict,
+	.insert = twoq_insert,
+	.remove = twoq_remove,
+	.next = twoq_next,
+	.destroy = twoq_destroy,
+};
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// ARC (Megiddo and Modha): T1 keeps the keys used once recently and T2 the
+// ones used at least twice, both in LRU order, while B1 and B2 remember the
+// keys evicted from them. A key coming back while remembered in B1 means T1
+// was too small, so its target size p grows; one remembered in B2 makes it
+// shrink. The eviction takes from T1 while it is over p, from T2 otherwise,
+// so the split between recency and frequency follows the workload, without
+// any parameter.
+
+#include "cache_policy.h"
+
+// The lists of the entries, in the order they are walked
+enum { ARC_T1, ARC_T2, ARC_LISTS };
+
+typedef struct arc_state {
+	ll_list_t *lists[ARC_LISTS];
+	ghost_list *b1, *b2;
+
+	unsigned int capacity;
+
+	// Target size of T1
+	unsigned int p;
+
+	// List the key given to the last admit enters, whether it was
+	// remembered in B2, and whether there was an admit since the last insert
+	unsigned int incoming;
+	bool in_b2;
+	bool admitted;
+} arc_state;
+
+static void *arc_create(unsigned int capacity, arena_t *arena)
+{
+	arc_state *a = malloc(sizeof(*a));
+	DIE(!a, "malloc arc");
+
+	for (unsigned int i = 0; i < ARC_LISTS; i++)
+		a->lists[i] = ll_create(sizeof(cache_entry));
+
+	a->b1 = ghost_create(capacity, arena);
+	a->b2 = ghost_create(capacity, arena);
+	a->capacity = capacity;
+	a->p = 0;
+	a->incoming = ARC_T1;
+	a->in_b2 = false;
+	a->admitted = false;
+
+	return a;
+}
+
+static void arc_resize(void *state, unsigned int capacity)
+{
+	arc_state *a = state;
+
+	// The ghost lists shrink right away, the other lists as their keys are
+	// evicted
+	a->capacity = capacity;
+	if (a->p > capacity)
+		a->p = capacity;
+
+	ghost_trim(a->b1, capacity);
+	ghost_trim(a->b2, capacity);
+}
+
+static void arc_hit(void *state, ll_node_t *node)
+{
+	arc_state *a = state;
+	cache_entry *entry = node->data;
+
+	// A key used again is frequent, whichever list it was in
+	if (entry->list == ARC_T2) {
+		ll_move_node_to_end(a->lists[ARC_T2], node);
+		return;
+	}
+
+	ll_remove_node(a->lists[ARC_T1], node);
+	entry->list = ARC_T2;
+	ll_link_node_end(a->lists[ARC_T2], node);
+}
+
+static void arc_admit(void *state, const char *key)
+{
+	arc_state *a = state;
+	ll_list_t *t1 = a->lists[ARC_T1], *t2 = a->lists[ARC_T2];
+	unsigned int b1 = a->b1->keys->size, b2 = a->b2->keys->size;
+	unsigned int c = a->capacity;
+
+	a->admitted = true;
+
+	// Remembered in B1: grow T1, by more when B1 is the smaller ghost list
+	ll_node_t *ghost = ghost_find(a->b1, key);
+	if (ghost) {
+		unsigned int delta = b2 > b1 ? b2 / b1 : 1;
+		a->p = a->p + delta < c ? a->p + delta : c;
+
+		ghost_remove(a->b1, ghost);
+		a->incoming = ARC_T2;
+		a->in_b2 = false;
+		return;
+	}
+
+	// Remembered in B2: shrink T1
+	ghost = ghost_find(a->b2, key);
+	if (ghost) {
+		unsigned int delta = b1 > b2 ? b1 / b2 : 1;
+		a->p = a->p > delta ? a->p - delta : 0;
+
+		ghost_remove(a->b2, ghost);
+		a->incoming = ARC_T2;
+		a->in_b2 = true;
+		return;
+	}
+
+	// A new key enters T1, which with B1 holds at most c keys
+	a->incoming = ARC_T1;
+	a->in_b2 = false;
+	if (t1->size + b1 >= c) {
+		if (t1->size < c)
+			ghost_trim(a->b1, c - t1->size - 1);
+		return;
+	}
+
+	// All the lists together hold at most 2c keys
+	unsigned int total = t1->size + b1 + t2->size + b2;
+	if (total >= 2 * c) {
+		unsigned int excess = total - 2 * c + 1;
+		ghost_trim(a->b2, b2 > excess ? b2 - excess : 0);
+	}
+}
+
+/*
+ * arc_evict() - Evicts the least recently used key of T1 if T1 is over its
+ * target size, the one of T2 otherwise, and remembers it.
+ */
+static ll_node_t *arc_evict(void *state)
+{
+	arc_state *a = state;
+	ll_list_t *t1 = a->lists[ARC_T1], *t2 = a->lists[ARC_T2];
+
+	// T1 holds the whole cache, so a new key evicts its first key without
+	// remembering it
+	if (a->admitted && a->incoming == ARC_T1 && t1->size >= a->capacity)
+		return ll_remove_node(t1, t1->head);
+
+	bool from_t1 = t1->size &&
+				   (t1->size > a->p || (a->in_b2 && t1->size == a->p) ||
+					!t2->size);
+
+	ll_list_t *list = from_t1 ? t1 : t2;
+	ll_node_t *victim = ll_remove_node(list, list->head);
+
+	ghost_push(from_t1 ? a->b1 : a->b2, ((info_t *)victim->data)->key);
+	return victim;
+}
+
+static void arc_insert(void *state, ll_node_t *node)
+{
+	arc_state *a = state;
+	cache_entry *entry = node->data;
+
+	// A node put back returns to its list
+	if (a->admitted)
+		entry->list = a->incoming;
+	a->admitted = false;
+	a->in_b2 = false;
+
+	ll_link_node_end(a->lists[entry->list], node);
+}
+
+static void arc_remove(void *state, ll_node_t *node)
+{
+	arc_state *a = state;
+
+	ll_remove_node(a->lists[((cache_entry *)node->data)->list], node);
+}
+
+static ll_node_t *arc_next(void *state, ll_node_t *node)
+{
+	return policy_lists_next(((arc_state *)state)->lists, ARC_LISTS, node);
+}
+
+static void arc_destroy(void *state)
+{
+	arc_state *a = state;
+
+	for (unsigned int i = 0; i < ARC_LISTS; i++)
+		free(a->lists[i]);
+	ghost_free(a->b1);
+	ghost_free(a->b2);
+	free(a);
+}
+
+const cache_policy policy_arc = {
+	.name = "arc",
+	.entry_size = sizeof(cache_entry),
+	.create = arc_create,
+	.resize = arc_resize,
+	.hit = arc_hit,
+	.admit = arc_admit,
+	.evict = arc_evict,
+	.insert = arc_insert,
+	.remove = arc_remove,
+	.next = arc_next,
+	.destroy = arc_destroy,
+};
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// CLOCK (second chance): a hit only sets the referenced bit of its entry,
+// without moving it. The hand goes around the entries, clearing the bits it
+// finds set, and evicts the first entry whose bit is clear.
+//
+// The list is kept starting at the hand, so moving the hand is moving the
+// first node to the end, and the new entries are added right behind the
+// hand, as the last ones it reaches.
+//
+// A node taken out while a cached key grows goes back where it was, before
+// the node which followed it. Meanwhile, the hand passes its place as if it
+// were there, clearing its bit, but does not evict it.
+
+#include "cache_policy.h"
+
+typedef struct clock_state {
+	// The entries, starting at the hand
+	ll_list_t *ring;
+
+	// Whether there was an admit since the last insert
+	bool admitted;
+
+	// The node taken out by remove, until it is put back (NULL if none),
+	// the node it goes back before (NULL if the ring is empty) and whether
+	// the hand is at its place, so it would be the next one looked at
+	ll_node_t *taken;
+	ll_node_t *taken_next;
+	bool under_hand;
+} clock_state;
+
+static void *clock_create(unsigned int capacity, arena_t *arena)
+{
+	(void)capacity;
+	(void)arena;
+
+	clock_state *c = malloc(sizeof(*c));
+	DIE(!c, "malloc clock");
+
+	c->ring = ll_create(sizeof(cache_entry));
+	c->admitted = false;
+	c->taken = NULL;
+
+	return c;
+}
+
+static void clock_hit(void *state, ll_node_t *node)
+{
+	(void)state;
+
+	((cache_entry *)node->data)->referenced = true;
+}
+
+static void clock_admit(void *state, const char *key)
+{
+	(void)key;
+
+	clock_state *c = state;
+
+	// A node taken out before was removed for good
+	c->admitted = true;
+	c->taken = NULL;
+}
+
+static ll_node_t *clock_evict(void *state)
+{
+	clock_state *c = state;
+	ll_list_t *ring = c->ring;
+
+	// Give the referenced entries a second chance; the loop ends after one
+	// turn at most, since the bits are cleared on the way
+	while (true) {
+		// The hand passes the place of the node taken out, without
+		// evicting it
+		if (c->taken && c->under_hand) {
+			((cache_entry *)c->taken->data)->referenced = false;
+			c->under_hand = false;
+		}
+
+		if (!((cache_entry *)ring->head->data)->referenced)
+			break;
+
+		((cache_entry *)ring->head->data)->referenced = false;
+		ll_move_node_to_end(ring, ring->head);
+
+		// The hand reaches the place of the node taken out
+		c->under_hand = ring->head == c->taken_next;
+	}
+
+	ll_node_t *victim = ll_remove_node(ring, ring->head);
+
+	// The node taken out goes back before the one after the victim, which
+	// the hand is past; otherwise the hand may have reached its place
+	if (c->taken && victim == c->taken_next)
+		c->taken_next = ring->head;
+	else if (c->taken)
+		c->under_hand = ring->head == c->taken_next;
+
+	return victim;
+}
+
+static void clock_insert(void *state, ll_node_t *node)
+{
+	clock_state *c = state;
+
+	// A new entry starts with its bit clear, right behind the hand
+	if (c->admitted) {
+		((cache_entry *)node->data)->referenced = false;
+		c->admitted = false;
+		ll_link_node_end(c->ring, node);
+		return;
+	}
+
+	// A node put back keeps its bit (unless the hand cleared it) and goes
+	// before the node which followed it; when that node is under the hand,
+	// the place is right behind the hand, unless the hand is at it
+	ll_node_t *next = c->taken_next;
+	if (next == c->ring->head && !c->under_hand)
+		next = NULL;
+
+	ll_link_node_before(c->ring, node, next);
+	c->taken = NULL;
+}
+
+static void clock_remove(void *state, ll_node_t *node)
+{
+	clock_state *c = state;
+	ll_list_t *ring = c->ring;
+
+	// Remember the node after it on the ring, in case it is put back
+	c->taken = node;
+	c->taken_next = node->next ? node->next : ring->head;
+	if (c->taken_next == node)
+		c->taken_next = NULL;
+	c->under_hand = node == ring->head;
+
+	ll_remove_node(ring, node);
+}
+
+static ll_node_t *clock_next(void *state, ll_node_t *node)
+{
+	return node ? node->next : ((clock_state *)state)->ring->head;
+}
+
+static void clock_destroy(void *state)
+{
+	free(((clock_state *)state)->ring);
+	free(state);
+}
+
+const cache_policy policy_clock = {
+	.name = "clock",
+	.entry_size = sizeof(cache_entry),
+	.create = clock_create,
+	.hit = clock_hit,
+	.admit = clock_admit,
+	.evict = clock_evict,
+	.insert = clock_insert,
+	.remove = clock_remove,
+	.next = clock_next,
+	.destroy = clock_destroy,
+};
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Least recently used: the nodes are kept in the order they were used, and
+// the first one is evicted
+
+#include "cache_policy.h"
+
+static void *lru_create(unsigned int capacity, arena_t *arena)
+{
+	(void)capacity;
+	(void)arena;
+
+	// The state is the list itself, from the least to the most recently used
+	return ll_create(sizeof(info_t));
+}
+
+static void lru_hit(void *state, ll_node_t *node)
+{
+	ll_move_node_to_end(state, node);
+}
+
+static void lru_admit(void *state, const char *key)
+{
+	(void)state;
+	(void)key;
+}
+
+static ll_node_t *lru_evict(void *state)
+{
+	ll_list_t *order = state;
+	return ll_remove_node(order, order->head);
+}
+
+static void lru_insert(void *state, ll_node_t *node)
+{
+	ll_link_node_end(state, node);
+}
+
+static void lru_remove(void *state, ll_node_t *node)
+{
+	ll_remove_node(state, node);
+}
+
+static ll_node_t *lru_next(void *state, ll_node_t *node)
+{
+	return node ? node->next : ((ll_list_t *)state)->head;
+}
+
+const cache_policy policy_lru = {
+	.name = "lru",
+	.entry_size = sizeof(info_t),
+	.create = lru_create,
+	.hit = lru_hit,
+	.admit = lru_admit,
+	.evict = lru_evict,
+	.insert = lru_insert,
+	.remove = lru_remove,
+	.next = lru_next,
+	.destroy = free,
+};
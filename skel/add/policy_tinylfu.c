@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// W-TinyLFU (Einziger, Friedman and Manes, as in Caffeine): a new key enters
+// a small LRU window (1% of the capacity). The key leaving the window is
+// only admitted to the main cache if a count-min sketch of the recent uses
+// of all the keys, cached or not, estimates it as more frequent than the key
+// the main cache would evict; otherwise it is the one evicted, so a scan or
+// a one-shot key does not push a frequent one out. The main cache is a
+// segmented LRU: the keys admitted wait in probation, and move to the
+// protected segment (80% of the main cache) when they are used again.
+
+#include "cache_policy.h"
+#include "sketch.h"
+
+// The lists of the entries, in the order they are walked
+enum { TLFU_PROBATION, TLFU_WINDOW, TLFU_PROTECTED, TLFU_LISTS };
+
+typedef struct tinylfu_state {
+	ll_list_t *lists[TLFU_LISTS];
+	sketch_t *sketch;
+
+	// Sizes the window and the protected segment are kept to
+	unsigned int window_size, protected_size;
+
+	// Key which left the window for the key given to the last admit, and
+	// has yet to win its place in the main cache; NULL when there is none
+	ll_node_t *candidate;
+
+	// Whether there was an admit since the last insert
+	bool admitted;
+} tinylfu_state;
+
+/*
+ * tinylfu_size() - Sets the sizes of the window and the protected segment
+ * from the capacity.
+ */
+static void tinylfu_size(tinylfu_state *t, unsigned int capacity)
+{
+	t->window_size = capacity / 100 ? capacity / 100 : 1;
+	t->protected_size = (capacity - t->window_size) * 4 / 5;
+}
+
+static void *tinylfu_create(unsigned int capacity, arena_t *arena)
+{
+	(void)arena;
+
+	tinylfu_state *t = malloc(sizeof(*t));
+	DIE(!t, "malloc tinylfu");
+
+	for (unsigned int i = 0; i < TLFU_LISTS; i++)
+		t->lists[i] = ll_create(sizeof(cache_entry));
+
+	t->sketch = sketch_create(capacity);
+	tinylfu_size(t, capacity);
+	t->candidate = NULL;
+	t->admitted = false;
+
+	return t;
+}
+
+/*
+ * move_entry() - Moves a node to the end of another list.
+ */
+static void move_entry(tinylfu_state *t, ll_node_t *node, unsigned int list)
+{
+	cache_entry *entry = node->data;
+
+	ll_remove_node(t->lists[entry->list], node);
+	entry->list = list;
+	ll_link_node_end(t->lists[list], node);
+}
+
+static void tinylfu_resize(void *state, unsigned int capacity)
+{
+	tinylfu_state *t = state;
+
+	tinylfu_size(t, capacity);
+	sketch_resize(t->sketch, capacity);
+
+	// The keys over the sizes of the window and of the protected segment go
+	// on probation, as if they had left them
+	ll_list_t *window = t->lists[TLFU_WINDOW];
+	while (window->size > t->window_size)
+		move_entry(t, window->head, TLFU_PROBATION);
+
+	ll_list_t *protected = t->lists[TLFU_PROTECTED];
+	while (protected->size > t->protected_size)
+		move_entry(t, protected->head, TLFU_PROBATION);
+}
+
+static void tinylfu_hit(void *state, ll_node_t *node)
+{
+	tinylfu_state *t = state;
+	cache_entry *entry = node->data;
+
+	sketch_increment(t->sketch, entry->info.key);
+
+	// A key used again while on probation is protected; the protected
+	// segment makes room by putting its least recently used keys back
+	if (entry->list == TLFU_PROBATION) {
+		move_entry(t, node, TLFU_PROTECTED);
+
+		ll_list_t *protected = t->lists[TLFU_PROTECTED];
+		while (protected->size > t->protected_size)
+			move_entry(t, protected->head, TLFU_PROBATION);
+		return;
+	}
+
+	ll_move_node_to_end(t->lists[entry->list], node);
+}
+
+/*
+ * detach_entry() - Unlinks a node from its list.
+ */
+static ll_node_t *detach_entry(tinylfu_state *t, ll_node_t *node)
+{
+	return ll_remove_node(t->lists[((cache_entry *)node->data)->list], node);
+}
+
+static void tinylfu_admit(void *state, const char *key)
+{
+	tinylfu_state *t = state;
+	ll_list_t *window = t->lists[TLFU_WINDOW];
+
+	sketch_increment(t->sketch, key);
+	t->admitted = true;
+
+	// When the window is full, its least recently used key goes on probation
+	// to make room for the new key; it is only kept there if it is more
+	// frequent than the key the main cache would evict instead
+	t->candidate = NULL;
+	if (window->size >= t->window_size) {
+		t->candidate = window->head;
+		move_entry(t, t->candidate, TLFU_PROBATION);
+	}
+}
+
+static ll_node_t *tinylfu_evict(void *state)
+{
+	tinylfu_state *t = state;
+	ll_node_t *candidate = t->candidate;
+	t->candidate = NULL;
+
+	// The victim of the main cache, other than the candidate itself
+	ll_node_t *victim = t->lists[TLFU_PROBATION]->head;
+	if (candidate && victim == candidate)
+		victim = candidate->next;
+	if (!victim)
+		victim = t->lists[TLFU_PROTECTED]->head;
+
+	// Without a candidate, the victim is evicted, or the key of the window
+	// if the main cache is empty
+	if (!candidate)
+		return detach_entry(t, victim ? victim : t->lists[TLFU_WINDOW]->head);
+
+	// Otherwise the least frequent of them is evicted; a tie keeps the key
+	// already in the main cache
+	if (!victim ||
+		sketch_frequency(t->sketch, ((info_t *)candidate->data)->key) <=
+		sketch_frequency(t->sketch, ((info_t *)victim->data)->key))
+		return detach_entry(t, candidate);
+
+	return detach_entry(t, victim);
+}
+
+static void tinylfu_insert(void *state, ll_node_t *node)
+{
+	tinylfu_state *t = state;
+	cache_entry *entry = node->data;
+
+	// A new key enters the window; a node put back returns to its list
+	if (t->admitted)
+		entry->list = TLFU_WINDOW;
+	t->admitted = false;
+	t->candidate = NULL;
+
+	ll_link_node_end(t->lists[entry->list], node);
+}
+
+static void tinylfu_remove(void *state, ll_node_t *node)
+{
+	detach_entry(state, node);
+}
+
+static ll_node_t *tinylfu_next(void *state, ll_node_t *node)
+{
+	return policy_lists_next(((tinylfu_state *)state)->lists, TLFU_LISTS,
+							 node);
+}
+
+static void tinylfu_destroy(void *state)
+{
+	tinylfu_state *t = state;
+
+	for (unsigned int i = 0; i < TLFU_LISTS; i++)
+		free(t->lists[i]);
+	sketch_free(t->sketch);
+	free(t);
+}
+
+const cache_policy policy_tinylfu = {
+	.name = "tinylfu",
+	.entry_size = sizeof(cache_entry),
+	.create = tinylfu_create,
+	.resize = tinylfu_resize,
+	.hit = tinylfu_hit,
+	.admit = tinylfu_admit,
+	.evict = tinylfu_evict,
+	.insert = tinylfu_insert,
+	.remove = tinylfu_remove,
+	.next = tinylfu_next,
+	.destroy = tinylfu_destroy,
+};
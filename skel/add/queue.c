@@ -7,15 +7,20 @@
 #include "queue.h"
 #include "../server.h"
 
-queue_t *q_create(unsigned int data_size, unsigned int max_size)
+// Gets the slot of the ring buffer at index i
+#define Q_SLOT(q, i) ((q)->buff + (size_t)(i) * (q)->data_size)
+
+queue_t *q_create(unsigned int data_size, unsigned int capacity)
 {
 	queue_t *q = calloc(1, sizeof(*q));
 	DIE(!q, "calloc queue failed");
 
 	q->data_size = data_size;
-	q->max_size = max_size;
+	q->capacity = 1;
+	while (q->capacity < capacity)
+		q->capacity *= 2;
 
-	q->buff = malloc(max_size * sizeof(*q->buff));
+	q->buff = malloc((size_t)q->capacity * data_size);
 	DIE(!q->buff, "malloc buffer failed");
 
 	return q;
@@ -36,7 +41,7 @@ void *q_front(queue_t *q)
 	if (!q || !q->size)
 		return NULL;
 
-	return q->buff[q->read_idx];
+	return Q_SLOT(q, q->read_idx);
 }
 
 int q_dequeue(queue_t *q)
@@ -44,25 +49,43 @@ int q_dequeue(queue_t *q)
 	if (!q || !q->size)
 		return 0;
 
-	free(q->buff[q->read_idx]);
-
-	q->read_idx = (q->read_idx + 1) % q->max_size;
+	q->read_idx = (q->read_idx + 1) & (q->capacity - 1);
 	--q->size;
 	return 1;
 }
 
+/*
+ * q_grow() - Doubles the buffer of a full queue, unwrapping its elements to
+ * the start of the new buffer.
+ */
+static void q_grow(queue_t *q)
+{
+	char *buff = malloc((size_t)q->capacity * 2 * q->data_size);
+	DIE(!buff, "malloc buffer failed");
+
+	// The elements from read_idx to the end, then the ones that wrapped
+	unsigned int tail = q->capacity - q->read_idx;
+	memcpy(buff, Q_SLOT(q, q->read_idx), (size_t)tail * q->data_size);
+	memcpy(buff + (size_t)tail * q->data_size, q->buff,
+		   (size_t)q->read_idx * q->data_size);
+
+	free(q->buff);
+	q->buff = buff;
+	q->read_idx = 0;
+	q->write_idx = q->size;
+	q->capacity *= 2;
+}
+
 int q_enqueue(queue_t *q, void *new_data)
 {
-	void *data;
-	if (!q || q->size == q->max_size)
+	if (!q || !new_data)
 		return 0;
 
-	data = malloc(q->data_size);
-	DIE(!data, "malloc data failed");
-	memcpy(data, new_data, q->data_size);
+	if (q->size == q->capacity)
+		q_grow(q);
 
-	q->buff[q->write_idx] = data;
-	q->write_idx = (q->write_idx + 1) % q->max_size;
+	memcpy(Q_SLOT(q, q->write_idx), new_data, q->data_size);
+	q->write_idx = (q->write_idx + 1) & (q->capacity - 1);
 	++q->size;
 
 	return 1;
@@ -70,13 +93,9 @@ int q_enqueue(queue_t *q, void *new_data)
 
 void q_clear(queue_t *q)
 {
-	unsigned int i;
-	if (!q || !q->size)
+	if (!q)
 		return;
 
-	for (i = q->read_idx; i != q->write_idx; i = (i + 1) % q->max_size)
-		free(q->buff[i]);
-
 	q->read_idx = 0;
 	q->write_idx = 0;
 	q->size = 0;
@@ -87,7 +106,6 @@ void q_free(queue_t *q)
 	if (!q)
 		return;
 
-	q_clear(q);
 	free(q->buff);
 	free(q);
 }
@@ -97,18 +115,9 @@ void q_free_request(queue_t *q)
 	if (!q)
 		return;
 
-	unsigned int i;
-
-	for (i = q->read_idx; i != q->write_idx; i = (i + 1) % q->max_size) {
-		free(((request *)q->buff[i])->doc_name);
-		free(((request *)q->buff[i])->doc_content);
-		free(q->buff[i]);
-	}
-
-	q->read_idx = 0;
-	q->write_idx = 0;
-	q->size = 0;
+	// Free the strings of the requests left in the queue
+	while (q->size)
+		q_dequeue_request(q);
 
-	free(q->buff);
-	free(q);
+	q_free(q);
 }
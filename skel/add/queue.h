@@ -10,24 +10,43 @@
 #include "../utils.h"
 
 typedef struct queue_t {
-	unsigned int max_size;
+	// Number of slots of the buffer (always a power of two); the buffer is
+	// doubled when it is full, so the queue never rejects an element
+	unsigned int capacity;
 	unsigned int size;
 	unsigned int data_size;
 	unsigned int read_idx;
 	unsigned int write_idx;
-	void **buff;
+
+	// The elements themselves, data_size bytes each, stored in the slots
+	char *buff;
 } queue_t;
 
-queue_t *q_create(unsigned int data_size, unsigned int max_size);
+/*
+ * q_create() - Creates a queue storing copies of data_size bytes.
+ *
+ * @param capacity: Initial number of slots, rounded up to a power of two.
+ */
+queue_t *q_create(unsigned int data_size, unsigned int capacity);
 
 unsigned int q_get_size(queue_t *q);
 
 unsigned int q_is_empty(queue_t *q);
 
+/*
+ * q_front() - Gets the first element of the queue, which is stored in the
+ * queue itself; the pointer is valid until the next enqueue or dequeue.
+ */
 void *q_front(queue_t *q);
 
 int q_dequeue(queue_t *q);
 
+/*
+ * q_enqueue() - Adds a copy of the element at the end of the queue, growing
+ * the queue if it is full.
+ *
+ * @return int - 1, unless the arguments are invalid.
+ */
 int q_enqueue(queue_t *q, void *new_data);
 
 int q_dequeue_request(queue_t *q);
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// For memmem
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "reader.h"
+#include "trace.h"
+
+reader_t *reader_open(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	DIE(fstat(fd, &st) < 0, "fstat");
+
+	// An empty file cannot be mapped; it has no header either
+	DIE(!st.st_size, "empty input file");
+
+	// The mapping is private, so the strings can be terminated in place
+	// without changing the file, and populated at once, instead of taking
+	// a page fault for every page
+	char *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	DIE(data == MAP_FAILED, "mmap");
+	close(fd);
+
+	// The file is read once, from the start to the end
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	reader_t *r = malloc(sizeof(*r));
+	DIE(!r, "malloc reader");
+
+	r->data = data;
+	r->size = st.st_size;
+	r->pos = 0;
+	r->trace = trace_is_trace(data, st.st_size);
+
+	return r;
+}
+
+/*
+ * next_line() - Gets the next line of the file, without its newline.
+ *
+ * @return char* - The start of the line, or NULL after the last one.
+ */
+static char *next_line(reader_t *r, size_t *len)
+{
+	if (r->pos >= r->size)
+		return NULL;
+
+	char *line = r->data + r->pos;
+	char *newline = memchr(line, '\n', r->size - r->pos);
+
+	*len = newline ? (size_t)(newline - line) : r->size - r->pos;
+	r->pos += *len + (newline ? 1 : 0);
+
+	return line;
+}
+
+/*
+ * parse_int() - Parses a number the way atoi does, without reading past
+ * the end of its line.
+ *
+ * @param next: Gets the character after the number.
+ */
+static int parse_int(const char *p, const char *end, const char **next)
+{
+	int sign = 1, value = 0;
+
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		sign = *p++ == '-' ? -1 : 1;
+
+	while (p < end && *p >= '0' && *p <= '9')
+		value = value * 10 + (*p++ - '0');
+
+	if (next)
+		*next = p;
+
+	return sign * value;
+}
+
+/*
+ * has_prefix() - Checks if a line starts with a word.
+ */
+static bool has_prefix(const char *line, size_t len, const char *word)
+{
+	size_t word_len = strlen(word);
+
+	return len >= word_len && !memcmp(line, word, word_len);
+}
+
+void reader_header(reader_t *r, int *requests_num, bool *enable_vnodes)
+{
+	if (r->trace) {
+		trace_read_header(r, requests_num, enable_vnodes);
+		return;
+	}
+
+	size_t len;
+	char *line = next_line(r, &len);
+
+	*requests_num = parse_int(line, line + len, NULL);
+	*enable_vnodes = memmem(line, len, "ENABLE_VNODES",
+							strlen("ENABLE_VNODES")) != NULL;
+}
+
+/*
+ * read_quoted() - Finds the string between the next two quotes, from start
+ * to end, and terminates it in place.
+ *
+ * @return char* - The closing quote, now a null byte, or NULL if there
+ * are not two quotes.
+ */
+static char *read_quoted(char *start, char *end, char **str, unsigned int *len)
+{
+	char *open_quote = memchr(start, '"', end - start);
+	if (!open_quote)
+		return NULL;
+
+	char *close_quote = memchr(open_quote + 1, '"', end - open_quote - 1);
+	if (!close_quote)
+		return NULL;
+
+	*str = open_quote + 1;
+	*len = close_quote - open_quote - 1;
+	*close_quote = '\0';
+
+	return close_quote;
+}
+
+bool reader_next(reader_t *r, parsed_request *req)
+{
+	if (r->trace)
+		return trace_read_next(r, req);
+
+	size_t len;
+	char *line = next_line(r, &len);
+	if (!line)
+		return false;
+
+	char *end = line + len;
+	memset(req, 0, sizeof(*req));
+
+	if (has_prefix(line, len, ADD_SERVER_REQUEST)) {
+		const char *args = line + strlen(ADD_SERVER_REQUEST);
+
+		req->type = ADD_SERVER;
+		req->server_id = parse_int(args, end, &args);
+		req->cache_size = parse_int(args, end, NULL);
+	} else if (has_prefix(line, len, REMOVE_SERVER_REQUEST)) {
+		req->type = REMOVE_SERVER;
+		req->server_id = parse_int(line + strlen(REMOVE_SERVER_REQUEST),
+								   end, NULL);
+	} else if (has_prefix(line, len, EDIT_REQUEST)) {
+		req->type = EDIT_DOCUMENT;
+
+		char *name_end = read_quoted(line, end, &req->doc_name,
+									 &req->doc_name_length);
+		DIE(!name_end, "document name is not properly quoted");
+
+		// The content may go on over the following lines, so its closing
+		// quote is searched for in the rest of the file
+		char *open_quote = memchr(name_end + 1, '"', end - name_end - 1);
+		DIE(!open_quote, "document content is not properly quoted");
+
+		char *content_end = read_quoted(open_quote, r->data + r->size,
+										&req->doc_content,
+										&req->doc_content_length);
+		DIE(!content_end, "document content is not properly quoted");
+
+		// Continue after the line the content ends on
+		char *newline = memchr(content_end, '\n',
+							   r->data + r->size - content_end);
+		r->pos = newline ? (size_t)(newline + 1 - r->data) : r->size;
+	} else if (has_prefix(line, len, GET_REQUEST)) {
+		req->type = GET_DOCUMENT;
+
+		DIE(!read_quoted(line, end, &req->doc_name, &req->doc_name_length),
+			"document name is not properly quoted");
+	} else if (has_prefix(line, len, STATS_REQUEST)) {
+		req->type = GET_STATS;
+	} else {
+		DIE(1, "unknown request type");
+	}
+
+	return true;
+}
+
+void reader_close(reader_t **r)
+{
+	if (!r || !*r)
+		return;
+
+	munmap((*r)->data, (*r)->size);
+	free(*r);
+	*r = NULL;
+}
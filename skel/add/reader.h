@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef READER_H
+#define READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../utils.h"
+
+// Reads the requests straight from a private mapping of the input file
+typedef struct reader_t {
+	// The mapped file and its size
+	char *data;
+	size_t size;
+
+	// Offset of the next line (or record) to be read
+	size_t pos;
+
+	// Whether the file is a compiled trace (see trace.h) instead of text
+	bool trace;
+} reader_t;
+
+// A request as it is found in the input file
+typedef struct parsed_request {
+	request_type type;
+
+	// Arguments of ADD_SERVER and REMOVE_SERVER
+	int server_id;
+	int cache_size;
+
+	// Arguments of EDIT and GET: slices of the mapping, terminated in place
+	// by a null byte written over their closing quotes; NULL when missing
+	char *doc_name;
+	unsigned int doc_name_length;
+	char *doc_content;
+	unsigned int doc_content_length;
+
+	// Hash of the name, if it was precomputed (by a compiled trace)
+	unsigned int doc_hash;
+	bool hashed;
+} parsed_request;
+
+/*
+ * reader_open() - Maps an input file, so it can be read without copying it.
+ * The file may also be a compiled trace, which is told apart by its magic
+ * number.
+ *
+ * @return reader_t* - The reader, or NULL if the file cannot be mapped.
+ */
+reader_t *reader_open(const char *path);
+
+/*
+ * reader_header() - Reads the first line of the input file.
+ *
+ * @param requests_num: Gets the number of requests.
+ * @param enable_vnodes: Gets whether virtual nodes are enabled.
+ */
+void reader_header(reader_t *r, int *requests_num, bool *enable_vnodes);
+
+/*
+ * reader_next() - Reads the next request; the content of an EDIT may span
+ * several lines.
+ *
+ * @return bool - False if there are no requests left.
+ *
+ * @brief The lines are searched with memchr and no memory is allocated:
+ * the strings of the request point into the mapping, which they are valid
+ * for as long as the reader is open.
+ */
+bool reader_next(reader_t *r, parsed_request *req);
+
+/*
+ * reader_close() - Unmaps the input file.
+ */
+void reader_close(reader_t **r);
+
+#endif /* READER_H */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "response.h"
+
+// Alignment of the parts of a packed response
+#define PACK_ALIGN 8
+
+// Gets the size of size bytes padded to PACK_ALIGN
+#define PACK_PADDED(size) \
+	(((size) + PACK_ALIGN - 1) & ~(size_t)(PACK_ALIGN - 1))
+
+/*
+ * write_msg() - Writes the response message of a response.
+ */
+static void write_msg(writer_t *w, const response *res)
+{
+	switch (res->msg) {
+	case RESPONSE_MSG_A:
+		writer_format(w, MSG_A, EDIT_REQUEST, res->doc_name);
+		break;
+	case RESPONSE_MSG_B:
+		writer_format(w, MSG_B, res->doc_name);
+		break;
+	case RESPONSE_MSG_C:
+		writer_format(w, MSG_C, res->doc_name);
+		break;
+	case RESPONSE_CONTENT:
+		writer_write(w, res->doc_content, blob_length(res->doc_content));
+		break;
+	default:
+		// A missing document is printed the way printf prints NULL
+		writer_format(w, "%s", NULL);
+	}
+}
+
+/*
+ * write_log() - Writes the log message of a response.
+ */
+static void write_log(writer_t *w, const response *res)
+{
+	switch (res->log) {
+	case RESPONSE_LOG_HIT:
+		writer_format(w, LOG_HIT, res->doc_name);
+		break;
+	case RESPONSE_LOG_MISS:
+		writer_format(w, LOG_MISS, res->doc_name);
+		break;
+	case RESPONSE_LOG_EVICT:
+		writer_format(w, res->evicted_num > 1 ? LOG_EVICT_MANY : LOG_EVICT,
+					  res->doc_name, res->evicted_key);
+		break;
+	case RESPONSE_LOG_HIT_EVICT:
+		writer_format(w, res->evicted_num > 1 ? LOG_HIT_EVICT_MANY :
+					  LOG_HIT_EVICT, res->doc_name, res->evicted_key);
+		break;
+	case RESPONSE_LOG_FAULT:
+		writer_format(w, LOG_FAULT, res->doc_name);
+		break;
+	case RESPONSE_LOG_LAZY_EXEC:
+		writer_format(w, LOG_LAZY_EXEC, res->queue_size);
+		break;
+	}
+}
+
+void response_write(writer_t *w, const response *res)
+{
+	const char *fmt = GENERIC_MSG;
+	const char *spec;
+	unsigned int strings = 0;
+
+	if (res->msg == RESPONSE_STATS) {
+		writer_write(w, res->doc_content, blob_length(res->doc_content));
+		return;
+	}
+
+	// Walk GENERIC_MSG, with the ID of the server for its %d conversions and
+	// the response, then the log message for its %s ones
+	while ((spec = strchr(fmt, '%'))) {
+		writer_write(w, fmt, spec - fmt);
+
+		if (spec[1] == 'd')
+			writer_format(w, "%d", res->server_id);
+		else if (strings++ == 0)
+			write_msg(w, res);
+		else
+			write_log(w, res);
+
+		fmt = spec + 2;
+	}
+
+	writer_write(w, fmt, strlen(fmt));
+}
+
+/*
+ * pack_string() - Writes a string as a blob: its header, then the string
+ * with its null byte and its padding; a missing string is a header with no
+ * references.
+ */
+static void pack_string(writer_t *w, const char *str, unsigned int length)
+{
+	static const char zeros[PACK_ALIGN];
+	blob_t header = {
+		.refcount = str ? 1 : 0,
+		.length = str ? length : 0,
+	};
+
+	writer_write(w, (const char *)&header, sizeof(header));
+	if (!str)
+		return;
+
+	writer_write(w, str, length + 1);
+	writer_write(w, zeros, PACK_PADDED(length + 1) - (length + 1));
+}
+
+/*
+ * unpack_string() - Reads a string written by pack_string and moves past it.
+ */
+static const char *unpack_string(const char **data)
+{
+	const blob_t *header = (const blob_t *)*data;
+	*data += sizeof(*header);
+
+	if (!header->refcount)
+		return NULL;
+
+	*data += PACK_PADDED(header->length + 1);
+	return header->data;
+}
+
+void response_pack(writer_t *w, const response *res)
+{
+	static const char zeros[PACK_ALIGN];
+
+	// The record itself, without its pointers
+	response copy = *res;
+	copy.doc_name = copy.evicted_key = copy.doc_content = NULL;
+	writer_write(w, (const char *)&copy, sizeof(copy));
+	writer_write(w, zeros, PACK_PADDED(sizeof(copy)) - sizeof(copy));
+
+	pack_string(w, res->doc_name, res->doc_name ? strlen(res->doc_name) : 0);
+	pack_string(w, res->evicted_key,
+				res->evicted_key ? strlen(res->evicted_key) : 0);
+	pack_string(w, res->doc_content,
+				res->doc_content ? blob_length(res->doc_content) : 0);
+}
+
+size_t response_unpack(const char *data, response *res)
+{
+	const char *start = data;
+
+	memcpy(res, data, sizeof(*res));
+	data += PACK_PADDED(sizeof(*res));
+
+	res->doc_name = unpack_string(&data);
+	res->evicted_key = unpack_string(&data);
+	res->doc_content = unpack_string(&data);
+
+	return data - start;
+}
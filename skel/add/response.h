@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef RESPONSE_H
+#define RESPONSE_H
+
+#include "blob.h"
+#include "writer.h"
+
+// The response messages of constants.h; GET answers with the content of the
+// document instead, or with nothing when it does not exist
+typedef enum response_msg {
+	RESPONSE_NONE,
+	RESPONSE_MSG_A,
+	RESPONSE_MSG_B,
+	RESPONSE_MSG_C,
+	RESPONSE_CONTENT,
+
+	// The report of a STATS request, in doc_content, printed as it is
+	// instead of as GENERIC_MSG
+	RESPONSE_STATS
+} response_msg;
+
+// The log messages of constants.h
+typedef enum response_log {
+	RESPONSE_LOG_HIT,
+	RESPONSE_LOG_MISS,
+	RESPONSE_LOG_EVICT,
+
+	// An EDIT of a cached document whose larger content evicted other keys
+	// (with a byte budget)
+	RESPONSE_LOG_HIT_EVICT,
+
+	RESPONSE_LOG_FAULT,
+	RESPONSE_LOG_LAZY_EXEC
+} response_log;
+
+typedef struct response {
+	// The kinds of the response and log messages
+	response_msg msg;
+	response_log log;
+
+	// The server ID
+	int server_id;
+
+	// Size of the task queue, for RESPONSE_LOG_LAZY_EXEC
+	unsigned int queue_size;
+
+	// Number of keys evicted, for RESPONSE_LOG_EVICT and
+	// RESPONSE_LOG_HIT_EVICT; when there are more than one, evicted_key lists
+	// them all, separated by commas
+	unsigned int evicted_num;
+
+	// The name of the document, the keys evicted from the cache (for
+	// RESPONSE_LOG_EVICT and RESPONSE_LOG_HIT_EVICT) and the content of the
+	// document (for RESPONSE_CONTENT); they are only borrowed, so the
+	// response has to be used before the next request reaches the server
+	const char *doc_name;
+	const char *evicted_key;
+	const char *doc_content;
+} response;
+
+/*
+ * response_write() - Writes the text of a response, as GENERIC_MSG.
+ *
+ * @brief The templates of the messages are expanded straight into the
+ * writer, so this is the only place where a response is formatted.
+ */
+void response_write(writer_t *w, const response *res);
+
+/*
+ * response_pack() - Writes a binary copy of a response, with copies of its
+ * strings, so it can be printed after the server moves on.
+ *
+ * @brief It has the signature of response_write, so a server can print its
+ * responses either way. The strings are packed as blobs, each with its
+ * header, aligned to 8 bytes, so the unpacked response can be printed by
+ * response_write straight from the packed bytes.
+ */
+void response_pack(writer_t *w, const response *res);
+
+/*
+ * response_unpack() - Reads a response written by response_pack.
+ *
+ * @param data: The packed response, aligned to 8 bytes.
+ * @param res: Gets the response, whose strings point into data.
+ *
+ * @return size_t - The size of the packed response.
+ */
+size_t response_unpack(const char *data, response *res);
+
+#endif /* RESPONSE_H */
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "shard.h"
+
+/*
+ * shard_handle() - Handles a request on a shard and keeps its responses,
+ * including the ones of the tasks it executes.
+ */
+static void shard_handle(shard_t *sh, shard_task *task)
+{
+	// The server reports the label it was reached through
+	task->s->label = task->label;
+
+	unsigned long start = latency_start(sh->latency);
+	response *res = server_handle_request(task->s, &task->req);
+
+	if (sh->latency)
+		latency_record(sh->latency, latency_outcome(task->req.type, res),
+					   start);
+
+	if (res)
+		response_write(sh->out, res);
+
+	// Count the GET as a hit if it was answered from the cache
+	if (task->req.type == GET_DOCUMENT) {
+		bool hit = res && res->log == RESPONSE_LOG_HIT;
+
+		sh->gets++;
+		sh->hits += hit;
+
+		if (task->in_window) {
+			sh->window_gets++;
+			sh->window_hits += hit;
+		}
+	} else {
+		// A queued EDIT took its strings, which were cleared here
+		free(task->req.doc_name);
+		blob_put(task->req.doc_content);
+	}
+
+	// Close the chunk of the request
+	if (sh->chunks_num == sh->chunks_capacity) {
+		sh->chunks_capacity *= 2;
+		sh->chunks = realloc(sh->chunks,
+							 sh->chunks_capacity * sizeof(*sh->chunks));
+		DIE(!sh->chunks, "realloc chunks");
+	}
+
+	writer_flush(sh->out);
+	sh->chunks[sh->chunks_num].seq = task->seq;
+	sh->chunks[sh->chunks_num].end = sh->out->memory_length;
+	sh->chunks_num++;
+}
+
+/*
+ * shard_run() - Handles the requests of a shard until it is stopped.
+ */
+static void *shard_run(void *arg)
+{
+	shard_t *sh = arg;
+	shard_task task;
+
+	// The main thread owns the standard output
+	writer_flush_on_exit(false);
+
+	while (true) {
+		spsc_pop(sh->tasks, &task);
+		if (!task.s)
+			break;
+
+		shard_handle(sh, &task);
+
+		// Publish the request after its responses and counters are written
+		unsigned long completed =
+			atomic_load_explicit(&sh->completed, memory_order_relaxed);
+		atomic_store_explicit(&sh->completed, completed + 1,
+							  memory_order_release);
+	}
+
+	return NULL;
+}
+
+shard_t *shard_start(void)
+{
+	shard_t *sh = aligned_alloc(SPSC_CACHE_LINE, sizeof(*sh));
+	DIE(!sh, "aligned_alloc shard");
+	memset(sh, 0, sizeof(*sh));
+
+	sh->tasks = spsc_create(sizeof(shard_task), SHARD_QUEUE_CAPACITY);
+	sh->out = writer_memory();
+
+	sh->chunks_capacity = SHARD_INITIAL_CHUNKS;
+	sh->chunks = malloc(sh->chunks_capacity * sizeof(*sh->chunks));
+	DIE(!sh->chunks, "malloc chunks");
+
+	atomic_init(&sh->completed, 0);
+
+	errno = pthread_create(&sh->thread, NULL, shard_run, sh);
+	DIE(errno, "pthread_create");
+
+	return sh;
+}
+
+void shard_dispatch(shard_t *sh, shard_task *task)
+{
+	spsc_push(sh->tasks, task);
+	sh->dispatched++;
+}
+
+void shard_wait(shard_t *sh)
+{
+	unsigned int rounds = 0;
+
+	while (atomic_load_explicit(&sh->completed, memory_order_acquire) !=
+		   sh->dispatched)
+		spsc_backoff(&rounds);
+}
+
+void shard_merge(shard_t **shards, unsigned int shards_num, writer_t *w)
+{
+	// Index of the next chunk of every shard; there are few shards, so the
+	// first chunks are simply scanned
+	unsigned int next[shards_num];
+	memset(next, 0, sizeof(next));
+
+	while (true) {
+		// Find the shard whose next chunk has the smallest sequence number
+		shard_t *first = NULL;
+		unsigned int first_idx = 0;
+		unsigned long first_seq = 0;
+
+		for (unsigned int i = 0; i < shards_num; i++) {
+			if (next[i] == shards[i]->chunks_num)
+				continue;
+
+			unsigned long seq = shards[i]->chunks[next[i]].seq;
+			if (!first || seq < first_seq) {
+				first = shards[i];
+				first_idx = i;
+				first_seq = seq;
+			}
+		}
+
+		// Every chunk was written
+		if (!first)
+			break;
+
+		// Write the responses of the chunk
+		unsigned int c = next[first_idx]++;
+		size_t start = c ? first->chunks[c - 1].end : 0;
+		writer_write(w, first->out->memory + start,
+					 first->chunks[c].end - start);
+	}
+
+	// Empty the shards for the next requests
+	for (unsigned int i = 0; i < shards_num; i++) {
+		shards[i]->chunks_num = 0;
+		shards[i]->out->memory_length = 0;
+	}
+}
+
+void shard_stop(shard_t **sh)
+{
+	if (!sh || !*sh)
+		return;
+
+	// A task without a server stops the thread
+	shard_task stop = { .s = NULL };
+	shard_dispatch(*sh, &stop);
+	pthread_join((*sh)->thread, NULL);
+
+	spsc_free(&(*sh)->tasks);
+	writer_close(&(*sh)->out);
+	free((*sh)->chunks);
+	latency_free(&(*sh)->latency);
+	free(*sh);
+	*sh = NULL;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <pthread.h>
+
+#include "latency.h"
+#include "spsc.h"
+#include "../server.h"
+
+// Number of requests which can wait for a shard before the main thread does
+#define SHARD_QUEUE_CAPACITY 1024
+
+// Initial number of chunks of responses a shard can keep
+#define SHARD_INITIAL_CHUNKS 1024
+
+// A request handed to a shard
+typedef struct shard_task {
+	// Sequence number of the request, in the order of the input
+	unsigned long seq;
+
+	// Server handling the request and the label it was reached through;
+	// a task without a server stops the shard
+	server *s;
+	int label;
+
+	// Whether the request is a GET in the window after a topology change
+	bool in_window;
+
+	// The request itself; the strings of an EDIT are owned by the task
+	request req;
+} shard_task;
+
+// The responses of a request, in the memory of a shard's writer
+typedef struct shard_chunk {
+	// Sequence number of the request
+	unsigned long seq;
+
+	// Offset where the responses end; they start where the previous chunk
+	// ends
+	size_t end;
+} shard_chunk;
+
+// A worker thread running the requests of a group of servers, which only
+// it touches between two syncs
+typedef struct shard_t {
+	pthread_t thread;
+
+	// Requests sent to the shard by the main thread
+	spsc_t *tasks;
+
+	// The responses of the requests, printed to memory, and the chunks
+	// telling them apart
+	writer_t *out;
+	shard_chunk *chunks;
+	unsigned int chunks_num;
+	unsigned int chunks_capacity;
+
+	// Number of GETs and of cache hits, overall and in the windows after
+	// the topology changes, since the last sync
+	unsigned long gets, hits;
+	unsigned long window_gets, window_hits;
+
+	// Latencies of the requests and task queues since the last sync; NULL
+	// when they are not recorded
+	latency_t *latency;
+
+	// Number of requests sent to the shard, counted by the main thread
+	unsigned long dispatched;
+
+	// Number of requests handled, published by the shard when their
+	// responses are in memory
+	_Alignas(SPSC_CACHE_LINE) atomic_ulong completed;
+} shard_t;
+
+/*
+ * shard_start() - Creates a shard and starts its thread.
+ *
+ * @brief The servers of the shard allocate their memory on its thread, so
+ * when an allocation fails, DIE ends the program from there. The main
+ * thread may be printing at the same time, so the buffered output is lost
+ * instead of being flushed; the responses merged before are kept.
+ */
+shard_t *shard_start(void);
+
+/*
+ * shard_dispatch() - Sends a request to a shard, waiting while its queue is
+ * full; only called by the main thread.
+ */
+void shard_dispatch(shard_t *sh, shard_task *task);
+
+/*
+ * shard_wait() - Waits until a shard has handled all the requests sent to
+ * it, so its servers, responses and counters can be read.
+ */
+void shard_wait(shard_t *sh);
+
+/*
+ * shard_merge() - Writes the responses of idle shards in the order of their
+ * requests, then empties the shards.
+ *
+ * @param shards: The shards, which have all been waited for.
+ * @param shards_num: The number of shards.
+ * @param w: The writer the responses are written to.
+ *
+ * @brief Every shard keeps its chunks sorted by their sequence numbers, so
+ * the chunk with the smallest sequence number among the first ones of the
+ * shards is always the next one.
+ */
+void shard_merge(shard_t **shards, unsigned int shards_num, writer_t *w);
+
+/*
+ * shard_stop() - Stops the thread of an idle shard and frees the shard.
+ */
+void shard_stop(shard_t **sh);
+
+#endif /* SHARD_H */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "sketch.h"
+
+/*
+ * sketch_width() - Gets the width of the rows for about capacity keys: a
+ * power of two, so a hash is reduced to an index with a mask.
+ */
+static unsigned int sketch_width(unsigned int capacity)
+{
+	unsigned int width = 16;
+	while (width < capacity)
+		width <<= 1;
+
+	return width;
+}
+
+/*
+ * sketch_reset() - Allocates zeroed rows of the given width.
+ */
+static void sketch_reset(sketch_t *s, unsigned int width)
+{
+	s->width = width;
+	s->counters = calloc(SKETCH_DEPTH * s->width, sizeof(*s->counters));
+	DIE(!s->counters, "calloc sketch counters");
+
+	s->additions = 0;
+	s->sample_size = SKETCH_SAMPLE_FACTOR * s->width;
+}
+
+sketch_t *sketch_create(unsigned int capacity)
+{
+	sketch_t *s = malloc(sizeof(*s));
+	DIE(!s, "malloc sketch");
+
+	sketch_reset(s, sketch_width(capacity));
+
+	return s;
+}
+
+void sketch_resize(sketch_t *s, unsigned int capacity)
+{
+	unsigned int width = sketch_width(capacity);
+	if (width == s->width)
+		return;
+
+	free(s->counters);
+	sketch_reset(s, width);
+}
+
+/*
+ * sketch_indices() - Gets the counter of a key in every row, by double
+ * hashing: the hash of the key is mixed into two halves, and the index in
+ * row i is the first half plus i times the second one.
+ */
+static void sketch_indices(const sketch_t *s, const char *key,
+						   unsigned int *idx)
+{
+	// The finalizer of splitmix64 spreads the bits of hash_string
+	unsigned long h = hash_string((void *)key);
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9UL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebUL;
+	h ^= h >> 31;
+
+	unsigned int h1 = h, h2 = (h >> 32) | 1;
+	for (unsigned int i = 0; i < SKETCH_DEPTH; i++)
+		idx[i] = i * s->width + ((h1 + i * h2) & (s->width - 1));
+}
+
+/*
+ * sketch_halve() - Halves all the counters, so the old uses of the keys
+ * weigh less than the recent ones.
+ */
+static void sketch_halve(sketch_t *s)
+{
+	for (unsigned int i = 0; i < SKETCH_DEPTH * s->width; i++)
+		s->counters[i] >>= 1;
+
+	s->additions /= 2;
+}
+
+void sketch_increment(sketch_t *s, const char *key)
+{
+	unsigned int idx[SKETCH_DEPTH];
+	sketch_indices(s, key, idx);
+
+	unsigned int min = SKETCH_MAX_COUNT;
+	for (unsigned int i = 0; i < SKETCH_DEPTH; i++)
+		if (s->counters[idx[i]] < min)
+			min = s->counters[idx[i]];
+
+	// The key is already as frequent as it can be
+	if (min == SKETCH_MAX_COUNT)
+		return;
+
+	for (unsigned int i = 0; i < SKETCH_DEPTH; i++)
+		if (s->counters[idx[i]] == min)
+			s->counters[idx[i]]++;
+
+	if (++s->additions == s->sample_size)
+		sketch_halve(s);
+}
+
+unsigned int sketch_frequency(const sketch_t *s, const char *key)
+{
+	unsigned int idx[SKETCH_DEPTH];
+	sketch_indices(s, key, idx);
+
+	unsigned int min = SKETCH_MAX_COUNT;
+	for (unsigned int i = 0; i < SKETCH_DEPTH; i++)
+		if (s->counters[idx[i]] < min)
+			min = s->counters[idx[i]];
+
+	return min;
+}
+
+void sketch_free(sketch_t *s)
+{
+	if (!s)
+		return;
+
+	free(s->counters);
+	free(s);
+}
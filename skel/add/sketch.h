@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include "../utils.h"
+
+// Number of rows of the sketch, each indexed by a different hash of the key
+#define SKETCH_DEPTH 4
+
+// Counters stop at 15, as 4-bit counters would: only the keys which are
+// used rarely have to be told apart from the frequent ones
+#define SKETCH_MAX_COUNT 15
+
+// The counters are halved after this many increments per counter of a row,
+// so the frequencies follow the recent history
+#define SKETCH_SAMPLE_FACTOR 10
+
+// Count-min sketch of the frequencies of the keys: a key increments one
+// counter in every row, and its frequency is the smallest of them, which is
+// never below the number of its increments since the last halving
+typedef struct sketch_t {
+	// SKETCH_DEPTH rows of width counters
+	unsigned char *counters;
+	unsigned int width;
+
+	// Increments since the last halving, and the number which halves them
+	unsigned int additions;
+	unsigned int sample_size;
+} sketch_t;
+
+/*
+ * sketch_create() - Creates a sketch for about capacity keys.
+ */
+sketch_t *sketch_create(unsigned int capacity);
+
+/*
+ * sketch_resize() - Sizes a sketch for about capacity keys; when its width
+ * changes, the keys map to other counters, so the counts start over.
+ */
+void sketch_resize(sketch_t *s, unsigned int capacity);
+
+/*
+ * sketch_increment() - Counts a use of a key; only the smallest of its
+ * counters are incremented (conservative update), which keeps the other keys
+ * sharing the larger ones from being overestimated.
+ */
+void sketch_increment(sketch_t *s, const char *key);
+
+/*
+ * sketch_frequency() - Estimates the number of uses of a key.
+ */
+unsigned int sketch_frequency(const sketch_t *s, const char *key);
+
+void sketch_free(sketch_t *s);
+
+#endif /* SKETCH_H */
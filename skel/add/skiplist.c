@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "skiplist.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+static unsigned int node_size(unsigned int level)
+{
+	return sizeof(sl_node_t) + level * sizeof(sl_node_t *);
+}
+
+static sl_node_t *node_create(skiplist_t *sl, unsigned int level)
+{
+	sl_node_t *node = arena_alloc(sl->arena, node_size(level));
+	memset(node, 0, node_size(level));
+	node->level = level;
+
+	return node;
+}
+
+/*
+ * random_level() - Gets the level of a new node: every level is reached
+ * with a 1/4 chance from the previous one.
+ */
+static unsigned int random_level(skiplist_t *sl)
+{
+	// xorshift32
+	sl->seed ^= sl->seed << 13;
+	sl->seed ^= sl->seed >> 17;
+	sl->seed ^= sl->seed << 5;
+
+	unsigned int level = 1;
+	for (unsigned int bits = sl->seed; (bits & 3) == 0 &&
+		 level < SL_MAX_LEVEL; bits >>= 2)
+		level++;
+
+	return level;
+}
+
+/*
+ * before() - Checks if a node is sorted before the (hash, key) pair.
+ */
+static bool before(sl_node_t *node, unsigned int hash, void *key)
+{
+	if (node->hash != hash)
+		return node->hash < hash;
+
+	return (uintptr_t)node->key < (uintptr_t)key;
+}
+
+/*
+ * seek() - Sets the finger of the list to the last node before (hash, key)
+ * on every level.
+ *
+ * @brief The search on a level starts from the node the finger already
+ * points to, if it is further than the one reached from the level above
+ * and still before the pair, so increasing pairs are reached in O(1).
+ */
+static void seek(skiplist_t *sl, unsigned int hash, void *key)
+{
+	sl_node_t *node = sl->head;
+
+	for (int i = sl->level - 1; i >= 0; i--) {
+		sl_node_t *finger = sl->finger[i];
+
+		if (finger && finger != sl->head && before(finger, hash, key) &&
+			(node == sl->head || before(node, finger->hash, finger->key)))
+			node = finger;
+
+		while (node->next[i] && before(node->next[i], hash, key))
+			node = node->next[i];
+		sl->finger[i] = node;
+	}
+}
+
+skiplist_t *sl_create(arena_t *arena)
+{
+	skiplist_t *sl = calloc(1, sizeof(*sl));
+	DIE(!sl, "calloc skiplist");
+
+	sl->arena = arena;
+	sl->seed = 2463534242u;
+	sl->level = 1;
+	sl->head = node_create(sl, SL_MAX_LEVEL);
+
+	return sl;
+}
+
+void sl_insert(skiplist_t *sl, unsigned int hash, void *key)
+{
+	sl_node_t **prev = sl->finger;
+	seek(sl, hash, key);
+
+	// The new levels start from the head
+	unsigned int level = random_level(sl);
+	for (; sl->level < level; sl->level++)
+		prev[sl->level] = sl->head;
+
+	sl_node_t *node = node_create(sl, level);
+	node->hash = hash;
+	node->key = key;
+
+	// The node is the last one before the next bigger pair
+	for (unsigned int i = 0; i < level; i++) {
+		node->next[i] = prev[i]->next[i];
+		prev[i]->next[i] = node;
+		prev[i] = node;
+	}
+
+	sl->size++;
+}
+
+void sl_remove(skiplist_t *sl, unsigned int hash, void *key)
+{
+	sl_node_t **prev = sl->finger;
+	seek(sl, hash, key);
+
+	sl_node_t *node = prev[0]->next[0];
+	if (!node || node->key != key)
+		return;
+
+	for (unsigned int i = 0; i < node->level; i++)
+		prev[i]->next[i] = node->next[i];
+
+	// Drop the levels left empty; the finger is left on the node before
+	// the removed one, on every level
+	while (sl->level > 1 && !sl->head->next[sl->level - 1])
+		sl->level--;
+
+	arena_free(sl->arena, node, node_size(node->level));
+	sl->size--;
+}
+
+sl_node_t *sl_upper_bound(skiplist_t *sl, unsigned int hash)
+{
+	sl_node_t *node = sl->head;
+
+	for (int i = sl->level - 1; i >= 0; i--)
+		while (node->next[i] && node->next[i]->hash <= hash)
+			node = node->next[i];
+
+	return node->next[0];
+}
+
+sl_node_t *sl_first(skiplist_t *sl)
+{
+	return sl->head->next[0];
+}
+
+void sl_clear(skiplist_t *sl)
+{
+	if (!sl)
+		return;
+
+	sl_node_t *node = sl->head->next[0];
+	while (node) {
+		sl_node_t *next = node->next[0];
+		arena_free(sl->arena, node, node_size(node->level));
+		node = next;
+	}
+
+	memset(sl->head->next, 0, SL_MAX_LEVEL * sizeof(*sl->head->next));
+	memset(sl->finger, 0, sizeof(sl->finger));
+	sl->level = 1;
+	sl->size = 0;
+}
+
+void sl_free(skiplist_t **sl)
+{
+	if (!sl || !*sl)
+		return;
+
+	// The nodes allocated from an arena are released with the arena
+	if (!(*sl)->arena) {
+		sl_node_t *node = (*sl)->head;
+		while (node) {
+			sl_node_t *next = node->next[0];
+			free(node);
+			node = next;
+		}
+	}
+
+	free(*sl);
+	*sl = NULL;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include "arena.h"
+
+// Maximum number of levels of a node; enough for millions of keys
+#define SL_MAX_LEVEL 20
+
+typedef struct sl_node_t {
+	// Hash the node is sorted by; nodes with equal hashes are sorted by the
+	// address of their keys
+	unsigned int hash;
+
+	// Number of levels the node is linked in
+	unsigned int level;
+
+	// The key, which is only referenced
+	void *key;
+
+	// Next node on every level of the node
+	struct sl_node_t *next[];
+} sl_node_t;
+
+typedef struct skiplist_t {
+	// Sentinel node linked in all the levels, before the first node
+	sl_node_t *head;
+
+	// Number of levels in use
+	unsigned int level;
+
+	// The nodes before the position of the last insert or remove, on every
+	// level; the next operation starts from them, if they are before it
+	sl_node_t *finger[SL_MAX_LEVEL];
+
+	unsigned int size;
+
+	// State of the generator of the levels of the new nodes
+	unsigned int seed;
+
+	// Allocator for the nodes; NULL to use malloc
+	arena_t *arena;
+} skiplist_t;
+
+/*
+ * sl_create() - Creates an empty skip list of keys sorted by their hashes.
+ *
+ * @param arena: Allocator for the nodes, or NULL to use malloc.
+ */
+skiplist_t *sl_create(arena_t *arena);
+
+/*
+ * sl_insert() - Adds a key, which the list only references.
+ *
+ * @brief Inserting or removing keys in increasing order of their hashes
+ * takes O(1) amortized per key, since every operation continues from the
+ * position of the previous one.
+ */
+void sl_insert(skiplist_t *sl, unsigned int hash, void *key);
+
+/*
+ * sl_remove() - Removes a key, given the same hash it was inserted with.
+ */
+void sl_remove(skiplist_t *sl, unsigned int hash, void *key);
+
+/*
+ * sl_upper_bound() - Finds the first node whose hash is bigger than hash.
+ *
+ * @return sl_node_t* - The node, or NULL if there is none. The nodes after
+ * it are reached through next[0], in increasing order of their hashes.
+ */
+sl_node_t *sl_upper_bound(skiplist_t *sl, unsigned int hash);
+
+/*
+ * sl_first() - Gets the node with the smallest hash, or NULL.
+ */
+sl_node_t *sl_first(skiplist_t *sl);
+
+/*
+ * sl_clear() - Removes all the keys, in a single pass.
+ */
+void sl_clear(skiplist_t *sl);
+
+void sl_free(skiplist_t **sl);
+
+#endif /* SKIPLIST_H */
@@ -58,47 +58,75 @@ ll_node_t *ll_add_nth_node_info(ll_list_t *list, unsigned int n,
 	return new_node;
 }
 
-ll_node_t *move_node_to_end(ll_list_t *list, void *key)
+ll_node_t *ll_move_node_to_end(ll_list_t *list, ll_node_t *node)
 {
-	// Declare a node to iterate through the list
-	ll_node_t *node;
+	// Nothing to do if the node is already the last one
+	if (!list || !node || node == list->tail)
+		return node;
+
+	// Unlink the node; it is not the tail, so it has a next node
+	if (node->prev)
+		node->prev->next = node->next;
+	else
+		list->head = node->next;
+	node->next->prev = node->prev;
+
+	// Link the node after the tail
+	node->prev = list->tail;
+	node->next = NULL;
+	list->tail->next = node;
+	list->tail = node;
+
+	// Return the same node, which was only relinked
+	return node;
+}
 
-	// Find the node with the given key and remove it from the list
-	for (node = list->head; node; node = node->next) {
-		if (strcmp(((info_t *)node->data)->key, key) == 0) {
-			ll_node_t *prev = node->prev;
-			ll_node_t *next = node->next;
-			if (prev) {
-				prev->next = next;
-			} else {
-				list->head = next;
-			}
-			if (next) {
-				next->prev = prev;
-			} else {
-				list->tail = prev;
-			}
-			list->size--;
-
-			break;
-		}
-	}
+ll_node_t *ll_link_node_end(ll_list_t *list, ll_node_t *node)
+{
+	// Almost identical to adding a node at the end with ll_add_nth_node, but
+	// the node is allocated by the caller
 
-	// If the node was not found, return NULL
-	if (!node)
+	if (!list || !node)
 		return NULL;
 
-	// Add the node to the end of the list
-	ll_node_t *new_node = ll_add_nth_node_info(list, list->size, node->data);
+	node->prev = list->tail;
+	node->next = NULL;
 
-	// Free the old node
-	free(((info_t *)node->data)->key);
-	free(((info_t *)node->data)->value);
-	free(node->data);
-	free(node);
+	if (list->tail)
+		list->tail->next = node;
+	else
+		list->head = node;
+	list->tail = node;
 
-	// Return the new node
-	return new_node;
+	++list->size;
+
+	return node;
+}
+
+ll_node_t *ll_link_node_before(ll_list_t *list, ll_node_t *node,
+							   ll_node_t *next)
+{
+	// Almost identical to ll_link_node_end, but the node is linked before
+	// next (at the end of the list if next is NULL)
+
+	if (!list || !node)
+		return NULL;
+
+	if (!next)
+		return ll_link_node_end(list, node);
+
+	node->prev = next->prev;
+	node->next = next;
+
+	if (next->prev)
+		next->prev->next = node;
+	else
+		list->head = node;
+	next->prev = node;
+
+	++list->size;
+
+	return node;
 }
 
 void ll_free_info(ll_list_t **pp_list)
@@ -124,19 +152,3 @@ void ll_free_info(ll_list_t **pp_list)
 	free(*pp_list);
 	*pp_list = NULL;
 }
-
-ll_node_t *ll_get_node(ll_list_t *list, void *key)
-{
-	// Declare a node to iterate through the list
-	ll_node_t *node;
-
-	// Find the node with the given key
-	for (node = list->head; node; node = node->next) {
-		if (strcmp(((info_t *)node->data)->key, key) == 0) {
-			return node;
-		}
-	}
-
-	// If the node was not found, return NULL
-	return NULL;
-}
@@ -10,10 +10,13 @@
 ll_node_t *ll_add_nth_node_info(ll_list_t *list, unsigned int n,
 								const info_t *new_data);
 
-ll_node_t *move_node_to_end(ll_list_t *list, void *key);
+ll_node_t *ll_move_node_to_end(ll_list_t *list, ll_node_t *node);
 
-void ll_free_info(ll_list_t **pp_list);
+ll_node_t *ll_link_node_end(ll_list_t *list, ll_node_t *node);
+
+ll_node_t *ll_link_node_before(ll_list_t *list, ll_node_t *node,
+							   ll_node_t *next);
 
-ll_node_t *ll_get_node(ll_list_t *list, void *key);
+void ll_free_info(ll_list_t **pp_list);
 
 #endif /* SPECIFIC_LINKED_LIST_H */
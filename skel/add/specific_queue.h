@@ -10,6 +10,14 @@
 
 int q_dequeue_request(queue_t *q);
 
+/*
+ * q_enqueue_request() - Adds a request to the queue, taking ownership of its
+ * doc_name (malloc'ed) and doc_content (a blob); their pointers are cleared
+ * in the given request, so the caller does not free them.
+ *
+ * @return int - 1, unless the arguments are invalid; the queue grows when
+ * it is full, so requests are never dropped.
+ */
 int q_enqueue_request(queue_t *q, void *req);
 
 # endif /* SPECIFIC_QUEUE_H */
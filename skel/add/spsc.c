@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include <sched.h>
+
+#include "spsc.h"
+
+// Number of rounds spent spinning before yielding the processor
+#define SPSC_SPIN_ROUNDS 64
+
+// Gets the slot of the ring buffer at index i
+#define SPSC_SLOT(q, i) \
+	((q)->buff + (size_t)((i) & ((q)->capacity - 1)) * (q)->data_size)
+
+spsc_t *spsc_create(unsigned int data_size, unsigned int capacity)
+{
+	spsc_t *q = aligned_alloc(SPSC_CACHE_LINE, sizeof(*q));
+	DIE(!q, "aligned_alloc spsc");
+	memset(q, 0, sizeof(*q));
+
+	q->data_size = data_size;
+	q->capacity = 1;
+	while (q->capacity < capacity)
+		q->capacity *= 2;
+
+	q->buff = malloc((size_t)q->capacity * data_size);
+	DIE(!q->buff, "malloc spsc buffer");
+
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+
+	return q;
+}
+
+void spsc_backoff(unsigned int *rounds)
+{
+	if (++*rounds < SPSC_SPIN_ROUNDS)
+		atomic_signal_fence(memory_order_seq_cst);
+	else
+		sched_yield();
+}
+
+bool spsc_try_push(spsc_t *q, const void *data)
+{
+	// Only the producer writes the tail, so it reads it relaxed
+	unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+	// The indices only grow (and wrap around), so their difference is the
+	// number of elements in the ring
+	if (tail - q->cached_head == q->capacity) {
+		q->cached_head = atomic_load_explicit(&q->head,
+											  memory_order_acquire);
+		if (tail - q->cached_head == q->capacity)
+			return false;
+	}
+
+	memcpy(SPSC_SLOT(q, tail), data, q->data_size);
+
+	// Publish the element after it was written
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+	return true;
+}
+
+bool spsc_try_pop(spsc_t *q, void *data)
+{
+	unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+	if (head == q->cached_tail) {
+		q->cached_tail = atomic_load_explicit(&q->tail,
+											  memory_order_acquire);
+		if (head == q->cached_tail)
+			return false;
+	}
+
+	memcpy(data, SPSC_SLOT(q, head), q->data_size);
+
+	// Give the slot back after it was read
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+	return true;
+}
+
+void spsc_push(spsc_t *q, const void *data)
+{
+	unsigned int rounds = 0;
+
+	while (!spsc_try_push(q, data))
+		spsc_backoff(&rounds);
+}
+
+void spsc_pop(spsc_t *q, void *data)
+{
+	unsigned int rounds = 0;
+
+	while (!spsc_try_pop(q, data))
+		spsc_backoff(&rounds);
+}
+
+void spsc_free(spsc_t **q)
+{
+	if (!q || !*q)
+		return;
+
+	free((*q)->buff);
+	free(*q);
+	*q = NULL;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "../utils.h"
+
+// Size of a cache line, which the two ends of a ring are kept apart by
+#define SPSC_CACHE_LINE 64
+
+// Bounded ring buffer passing copies of data_size bytes from exactly one
+// producer thread to exactly one consumer thread, without locks
+typedef struct spsc_t {
+	// Number of slots (a power of two) and the size of an element
+	unsigned int capacity;
+	unsigned int data_size;
+	char *buff;
+
+	// Index of the next slot to write, advanced by the producer, and its
+	// copy of the consumer's index, refreshed only when the ring looks full
+	_Alignas(SPSC_CACHE_LINE) atomic_uint tail;
+	unsigned int cached_head;
+
+	// Index of the next slot to read, advanced by the consumer, and its
+	// copy of the producer's index, refreshed only when the ring looks empty
+	_Alignas(SPSC_CACHE_LINE) atomic_uint head;
+	unsigned int cached_tail;
+} spsc_t;
+
+/*
+ * spsc_create() - Creates a ring of elements of data_size bytes.
+ *
+ * @param capacity: Number of slots, rounded up to a power of two.
+ */
+spsc_t *spsc_create(unsigned int data_size, unsigned int capacity);
+
+/*
+ * spsc_try_push() - Copies an element at the end of the ring, unless it is
+ * full; only called by the producer.
+ *
+ * @return bool - Whether the element was added.
+ */
+bool spsc_try_push(spsc_t *q, const void *data);
+
+/*
+ * spsc_try_pop() - Moves the first element of the ring to data, unless it
+ * is empty; only called by the consumer.
+ *
+ * @return bool - Whether there was an element.
+ */
+bool spsc_try_pop(spsc_t *q, void *data);
+
+/*
+ * spsc_push() - Copies an element at the end of the ring, waiting for a
+ * free slot if it is full; only called by the producer.
+ */
+void spsc_push(spsc_t *q, const void *data);
+
+/*
+ * spsc_pop() - Moves the first element of the ring to data, waiting for one
+ * if it is empty; only called by the consumer.
+ */
+void spsc_pop(spsc_t *q, void *data);
+
+/*
+ * spsc_backoff() - Waits a little while polling: the first rounds only
+ * spin, the next ones give the processor away.
+ *
+ * @param rounds: Number of rounds waited so far, reset by the caller when
+ * the wait is over.
+ */
+void spsc_backoff(unsigned int *rounds);
+
+void spsc_free(spsc_t **q);
+
+#endif /* SPSC_H */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include "trace.h"
+
+/*
+ * padded() - Gets the size of a string with its null byte, padded to keep
+ * the fields after it aligned.
+ */
+static size_t padded(unsigned int length)
+{
+	return (length + 1 + 3) & ~(size_t)3;
+}
+
+bool trace_is_trace(const char *data, size_t size)
+{
+	return size >= sizeof(trace_header) &&
+		   !memcmp(data, TRACE_MAGIC, TRACE_MAGIC_LENGTH);
+}
+
+void trace_read_header(reader_t *r, int *requests_num, bool *enable_vnodes)
+{
+	const trace_header *header = (const trace_header *)r->data;
+	DIE(header->version != TRACE_VERSION, "unsupported trace version");
+
+	*requests_num = header->requests_num;
+	*enable_vnodes = header->flags & TRACE_VNODES;
+
+	r->pos = sizeof(*header);
+}
+
+/*
+ * take_fields() - Gets the next fields of a trace and moves past them.
+ */
+static uint32_t *take_fields(reader_t *r, unsigned int count)
+{
+	DIE(r->size - r->pos < count * sizeof(uint32_t), "truncated trace");
+
+	uint32_t *fields = (uint32_t *)(r->data + r->pos);
+	r->pos += count * sizeof(uint32_t);
+
+	return fields;
+}
+
+/*
+ * take_string() - Gets the next string of a trace and moves past it.
+ */
+static char *take_string(reader_t *r, unsigned int length)
+{
+	DIE(r->size - r->pos < padded(length), "truncated trace");
+
+	char *str = r->data + r->pos;
+	r->pos += padded(length);
+
+	return str;
+}
+
+bool trace_read_next(reader_t *r, parsed_request *req)
+{
+	if (r->pos >= r->size)
+		return false;
+
+	memset(req, 0, sizeof(*req));
+	req->type = *take_fields(r, 1);
+
+	uint32_t *fields;
+	switch (req->type) {
+	case ADD_SERVER:
+		fields = take_fields(r, 2);
+		req->server_id = fields[0];
+		req->cache_size = fields[1];
+		break;
+	case REMOVE_SERVER:
+		req->server_id = *take_fields(r, 1);
+		break;
+	case GET_DOCUMENT:
+		fields = take_fields(r, 2);
+		req->doc_hash = fields[0];
+		req->doc_name_length = fields[1];
+		req->doc_name = take_string(r, req->doc_name_length);
+		req->hashed = true;
+		break;
+	case EDIT_DOCUMENT:
+		fields = take_fields(r, 3);
+		req->doc_hash = fields[0];
+		req->doc_name_length = fields[1];
+		req->doc_content_length = fields[2];
+		req->doc_name = take_string(r, req->doc_name_length);
+		req->doc_content = take_string(r, req->doc_content_length);
+		req->hashed = true;
+		break;
+	case GET_STATS:
+		break;
+	default:
+		DIE(1, "unknown request type");
+	}
+
+	return true;
+}
+
+/*
+ * write_fields() - Writes a record's fields to a trace.
+ */
+static void write_fields(writer_t *out, const uint32_t *fields,
+						 unsigned int count)
+{
+	writer_write(out, (const char *)fields, count * sizeof(*fields));
+}
+
+/*
+ * write_string() - Writes a string to a trace, with its null byte and its
+ * padding.
+ */
+static void write_string(writer_t *out, const char *str, unsigned int length)
+{
+	static const char zeros[4];
+
+	writer_write(out, str, length);
+	writer_write(out, zeros, padded(length) - length);
+}
+
+void trace_compile(reader_t *in, int requests_num, bool enable_vnodes,
+				   writer_t *out)
+{
+	trace_header header = {
+		.version = TRACE_VERSION,
+		.requests_num = requests_num,
+		.flags = enable_vnodes ? TRACE_VNODES : 0,
+	};
+	memcpy(header.magic, TRACE_MAGIC, TRACE_MAGIC_LENGTH);
+	writer_write(out, (const char *)&header, sizeof(header));
+
+	parsed_request req;
+	for (int i = 0; i < requests_num; i++) {
+		DIE(!reader_next(in, &req), "insufficient requests");
+
+		if (req.type == ADD_SERVER) {
+			uint32_t fields[] = {req.type, req.server_id, req.cache_size};
+			write_fields(out, fields, 3);
+		} else if (req.type == REMOVE_SERVER) {
+			uint32_t fields[] = {req.type, req.server_id};
+			write_fields(out, fields, 2);
+		} else if (req.type == GET_STATS) {
+			uint32_t fields[] = {req.type};
+			write_fields(out, fields, 1);
+		} else if (req.type == GET_DOCUMENT) {
+			uint32_t fields[] = {req.type, hash_string(req.doc_name),
+								 req.doc_name_length};
+			write_fields(out, fields, 3);
+			write_string(out, req.doc_name, req.doc_name_length);
+		} else {
+			uint32_t fields[] = {req.type, hash_string(req.doc_name),
+								 req.doc_name_length,
+								 req.doc_content_length};
+			write_fields(out, fields, 4);
+			write_string(out, req.doc_name, req.doc_name_length);
+			write_string(out, req.doc_content, req.doc_content_length);
+		}
+	}
+}
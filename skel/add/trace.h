@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "reader.h"
+#include "writer.h"
+
+// A compiled trace holds the requests of an input file in binary, so they
+// can be replayed without being parsed again. It starts with a header:
+//
+//     "SDATRACE", u32 version, u32 requests_num, u32 flags, u32 reserved
+//
+// followed by one record per request, made of 32 bit fields:
+//
+//     ADD_SERVER:    op, server_id, cache_size
+//     REMOVE_SERVER: op, server_id
+//     GET:           op, hash, name_length, name
+//     EDIT:          op, hash, name_length, content_length, name, content
+//     STATS:         op
+//
+// where op is the request_type, hash is the hash_string of the name (the
+// hash the ring routes the document by), and the name and content keep
+// their null bytes and are padded to 4 bytes, so the fields stay aligned
+// and the strings can be used straight from the mapped trace.
+
+#define TRACE_MAGIC "SDATRACE"
+#define TRACE_MAGIC_LENGTH 8
+#define TRACE_VERSION 1
+
+// Flags of the header
+#define TRACE_VNODES 1
+
+typedef struct trace_header {
+	char magic[TRACE_MAGIC_LENGTH];
+	uint32_t version;
+	uint32_t requests_num;
+	uint32_t flags;
+	uint32_t reserved;
+} trace_header;
+
+/*
+ * trace_is_trace() - Checks if a file starts like a compiled trace.
+ */
+bool trace_is_trace(const char *data, size_t size);
+
+/*
+ * trace_read_header() - Reads the header of a compiled trace, for
+ * reader_header.
+ */
+void trace_read_header(reader_t *r, int *requests_num, bool *enable_vnodes);
+
+/*
+ * trace_read_next() - Reads the next record of a compiled trace, for
+ * reader_next; the request also gets the precomputed hash of its document.
+ */
+bool trace_read_next(reader_t *r, parsed_request *req);
+
+/*
+ * trace_compile() - Compiles the requests left in a reader into a trace.
+ *
+ * @param in: The reader of the input file, whose header was already read.
+ * @param requests_num: The number of requests of the input file.
+ * @param enable_vnodes: Whether the input file enables virtual nodes.
+ * @param out: The writer of the trace.
+ */
+void trace_compile(reader_t *in, int requests_num, bool enable_vnodes,
+				   writer_t *out);
+
+#endif /* TRACE_H */
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "writer.h"
+#include "../utils.h"
+
+// Enough for the digits and the sign of any int
+#define INT_DIGITS 12
+
+/*
+ * write_all() - Writes all the bytes of the given buffers, retrying after
+ * partial writes and interrupts.
+ */
+static void write_all(int fd, struct iovec *iov, int iovcnt)
+{
+	while (iovcnt) {
+		ssize_t written = writev(fd, iov, iovcnt);
+		if (written < 0 && errno == EINTR)
+			continue;
+		DIE(written < 0, "writev");
+
+		// Skip the buffers written completely, then the written part of
+		// the next one
+		while (iovcnt && (size_t)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt) {
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+}
+
+// Whether the thread ending the program should flush the standard output
+static __thread bool skip_exit_flush;
+
+static void flush_stdout(void)
+{
+	if (!skip_exit_flush)
+		writer_flush(writer_stdout());
+}
+
+void writer_flush_on_exit(bool flush)
+{
+	skip_exit_flush = !flush;
+}
+
+writer_t *writer_stdout(void)
+{
+	static writer_t out = { .fd = STDOUT_FILENO };
+	static int registered;
+
+	if (!registered) {
+		registered = 1;
+		atexit(flush_stdout);
+	}
+
+	return &out;
+}
+
+writer_t *writer_open(const char *path)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return NULL;
+
+	writer_t *w = malloc(sizeof(*w));
+	DIE(!w, "malloc writer");
+
+	w->fd = fd;
+	w->length = 0;
+	w->memory = NULL;
+	w->memory_length = w->memory_capacity = 0;
+
+	return w;
+}
+
+writer_t *writer_memory(void)
+{
+	writer_t *w = malloc(sizeof(*w));
+	DIE(!w, "malloc writer");
+
+	w->fd = -1;
+	w->length = 0;
+	w->memory = NULL;
+	w->memory_length = w->memory_capacity = 0;
+
+	return w;
+}
+
+/*
+ * append_memory() - Appends bytes to the memory of a writer, doubling it
+ * when they do not fit.
+ */
+static void append_memory(writer_t *w, const char *data, size_t size)
+{
+	if (w->memory_length + size > w->memory_capacity) {
+		size_t capacity = w->memory_capacity ? w->memory_capacity
+											 : WRITER_BUFFER_SIZE;
+		while (w->memory_length + size > capacity)
+			capacity *= 2;
+
+		w->memory = realloc(w->memory, capacity);
+		DIE(!w->memory, "realloc writer memory");
+		w->memory_capacity = capacity;
+	}
+
+	memcpy(w->memory + w->memory_length, data, size);
+	w->memory_length += size;
+}
+
+void writer_close(writer_t **w)
+{
+	if (!w || !*w)
+		return;
+
+	writer_flush(*w);
+	if ((*w)->fd >= 0)
+		close((*w)->fd);
+
+	free((*w)->memory);
+	free(*w);
+	*w = NULL;
+}
+
+void writer_flush(writer_t *w)
+{
+	if (!w->length)
+		return;
+
+	if (w->fd < 0) {
+		append_memory(w, w->buffer, w->length);
+		w->length = 0;
+		return;
+	}
+
+	struct iovec iov = { .iov_base = w->buffer, .iov_len = w->length };
+	write_all(w->fd, &iov, 1);
+	w->length = 0;
+}
+
+void writer_write(writer_t *w, const char *data, size_t size)
+{
+	// Most strings just fit in the buffer
+	if (size <= WRITER_BUFFER_SIZE - w->length) {
+		memcpy(w->buffer + w->length, data, size);
+		w->length += size;
+		return;
+	}
+
+	// A small string is worth copying into the emptied buffer
+	if (size < WRITER_BUFFER_SIZE / 2) {
+		writer_flush(w);
+		memcpy(w->buffer, data, size);
+		w->length = size;
+		return;
+	}
+
+	// A big one is appended to the memory after the buffer, or written
+	// together with the buffer, in a single call
+	if (w->fd < 0) {
+		writer_flush(w);
+		append_memory(w, data, size);
+		return;
+	}
+
+	struct iovec iov[2] = {
+		{ .iov_base = w->buffer, .iov_len = w->length },
+		{ .iov_base = (void *)data, .iov_len = size },
+	};
+	write_all(w->fd, iov, 2);
+	w->length = 0;
+}
+
+/*
+ * format_int() - Writes the decimal digits of a number at the end of a
+ * buffer of INT_DIGITS bytes.
+ *
+ * @return char* - The first digit (or the sign) of the number.
+ */
+static char *format_int(int value, char *buffer)
+{
+	char *digit = buffer + INT_DIGITS;
+
+	// Work on the unsigned value, so INT_MIN has a positive counterpart
+	unsigned int magnitude = value < 0 ? -(unsigned int)value
+									  : (unsigned int)value;
+
+	do {
+		*--digit = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+
+	if (value < 0)
+		*--digit = '-';
+
+	return digit;
+}
+
+void writer_format(writer_t *w, const char *fmt, ...)
+{
+	char digits[INT_DIGITS];
+	va_list args;
+
+	va_start(args, fmt);
+
+	// Expand the template piece by piece, without copying it first
+	while (*fmt) {
+		// Write the literal text up to the next conversion at once
+		const char *spec = strchr(fmt, '%');
+		size_t len = spec ? (size_t)(spec - fmt) : strlen(fmt);
+		writer_write(w, fmt, len);
+
+		if (!spec)
+			break;
+
+		const char *piece = spec;
+		if (spec[1] == 's') {
+			// A missing string is printed the way printf prints it
+			piece = va_arg(args, const char *);
+			if (!piece)
+				piece = "(null)";
+			len = strlen(piece);
+		} else if (spec[1] == 'd') {
+			piece = format_int(va_arg(args, int), digits);
+			len = digits + INT_DIGITS - piece;
+		} else {
+			DIE(spec[1] != '%', "unsupported conversion");
+			len = 1;
+		}
+
+		writer_write(w, piece, len);
+		fmt = spec + 2;
+	}
+
+	va_end(args);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size of the buffer of a writer; strings at least half as big are written
+// straight from where they are, next to the buffered bytes
+#define WRITER_BUFFER_SIZE (64 * 1024)
+
+// Buffered output to a file descriptor, which never allocates memory, or
+// to a block of memory growing as needed
+typedef struct writer_t {
+	// File descriptor the bytes are written to; -1 when writing to memory
+	int fd;
+
+	// Number of bytes waiting in the buffer
+	size_t length;
+
+	// The bytes flushed to memory, for a writer without a file descriptor;
+	// the owner of the writer consumes them and resets memory_length
+	char *memory;
+	size_t memory_length;
+	size_t memory_capacity;
+
+	char buffer[WRITER_BUFFER_SIZE];
+} writer_t;
+
+/*
+ * writer_stdout() - Gets the writer of the standard output.
+ *
+ * @brief It is flushed when the program exits, including through DIE, but
+ * not on its own; nothing else should write to stdout while it buffers.
+ */
+writer_t *writer_stdout(void);
+
+/*
+ * writer_flush_on_exit() - Sets whether the standard output is flushed when
+ * the calling thread ends the program (e.g. through DIE); it is by default.
+ *
+ * @brief A thread should turn it off while another one may be writing to
+ * the standard output, so ending the program loses the buffered output
+ * instead of writing it at the same time as the other thread.
+ */
+void writer_flush_on_exit(bool flush);
+
+/*
+ * writer_open() - Creates (or truncates) a file and opens a writer for it.
+ *
+ * @return writer_t* - The writer, or NULL if the file cannot be created.
+ */
+writer_t *writer_open(const char *path);
+
+/*
+ * writer_memory() - Opens a writer which collects the bytes in memory.
+ *
+ * @brief The bytes are only found in memory after writer_flush.
+ */
+writer_t *writer_memory(void);
+
+/*
+ * writer_close() - Flushes a writer opened with writer_open, then closes
+ * its file; a writer opened with writer_memory frees its memory instead.
+ */
+void writer_close(writer_t **w);
+
+/*
+ * writer_write() - Writes size bytes from data.
+ */
+void writer_write(writer_t *w, const char *data, size_t size);
+
+/*
+ * writer_format() - Writes a message template expanded with its arguments.
+ *
+ * @param fmt: A template supporting only %s, %d and %%, like the messages
+ * in constants.h.
+ *
+ * @brief The template is expanded by hand, straight into the buffer, so
+ * it is much cheaper than printf.
+ */
+void writer_format(writer_t *w, const char *fmt, ...);
+
+/*
+ * writer_flush() - Writes all the buffered bytes to the file descriptor, or
+ * appends them to the memory.
+ */
+void writer_flush(writer_t *w);
+
+#endif /* WRITER_H */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Counts the allocations of a program, when preloaded into it:
+//
+//     ALLOC_COUNT_OUT=<file> LD_PRELOAD=./alloc_count.so ./tema2 ...
+//
+// The allocator functions are replaced by ones counting the calls and the
+// requested bytes before calling the ones of glibc; the totals are written
+// to the file (or to stderr, without ALLOC_COUNT_OUT) when the program
+// exits, as "allocs=<calls> frees=<calls> bytes=<bytes>".
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+// The counters may be updated by several threads at once
+static unsigned long allocs, frees, bytes;
+
+static void count(size_t size)
+{
+	__atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&bytes, size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+	count(size);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	count(nmemb * size);
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	count(size);
+	return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	count(size);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+	count(size);
+	*ptr = __libc_memalign(alignment, size);
+	return *ptr ? 0 : ENOMEM;
+}
+
+void free(void *ptr)
+{
+	if (ptr)
+		__atomic_fetch_add(&frees, 1, __ATOMIC_RELAXED);
+	__libc_free(ptr);
+}
+
+__attribute__((destructor)) static void report(void)
+{
+	// Opening the file allocates too, so the totals are taken before
+	unsigned long total_allocs = allocs, total_frees = frees;
+	unsigned long total_bytes = bytes;
+
+	const char *path = getenv("ALLOC_COUNT_OUT");
+	FILE *out = path ? fopen(path, "w") : NULL;
+
+	fprintf(out ? out : stderr, "allocs=%lu frees=%lu bytes=%lu\n",
+			total_allocs, total_frees, total_bytes);
+
+	if (out)
+		fclose(out);
+}
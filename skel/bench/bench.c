@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "../utils.h"
+
+double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int mute_stdout(void)
+{
+	int out = dup(STDOUT_FILENO);
+	DIE(out < 0, "dup stdout");
+	DIE(!freopen("/dev/null", "w", stdout), "freopen");
+
+	return out;
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+// Helpers shared by the benchmarks, linked into every one of them
+
+/*
+ * now_ns() - Gets the time of the monotonic clock, in ns.
+ */
+double now_ns(void);
+
+/*
+ * mute_stdout() - Sends stdout, where the responses are printed, to
+ * /dev/null, so they are formatted but not shown.
+ *
+ * @return int - A descriptor of the original stdout, for the results.
+ */
+int mute_stdout(void);
+
+#endif /* BENCH_H */
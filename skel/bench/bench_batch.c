@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures the gain of forwarding the requests in batches grouped by their
+// servers, against forwarding them one by one: the time, the cache misses
+// of the processor (when its counters can be read) and the number of times
+// consecutive requests switch to another server
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../load_balancer.h"
+#include "../add/reader.h"
+#include "bench.h"
+
+#define BENCH_ROUNDS 9
+
+/*
+ * open_cache_misses() - Opens a counter of the cache misses of this thread.
+ *
+ * @return int - The file descriptor of the counter, or -1 if the processor
+ * counters are not available (e.g. in a virtual machine).
+ */
+static int open_cache_misses(void)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * route() - Finds the server of a document, like the load balancer does.
+ */
+static server *route(load_balancer *main, const char *name)
+{
+	unsigned int hash = main->hash_function_docs((void *)name);
+	unsigned int left = 0, right = main->ring_size;
+
+	while (left < right) {
+		unsigned int mid = left + (right - left) / 2;
+
+		if (main->ring[mid].hash < hash)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+
+	return main->ring[left == main->ring_size ? 0 : left].s;
+}
+
+static int compare_servers(const void *a, const void *b)
+{
+	server *x = *(server **)a, *y = *(server **)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * count_switches() - Counts the switches between servers while a batch is
+ * handled: one per server of the batch, or one per request which goes to
+ * another server than the previous one without batches.
+ */
+static unsigned long count_switches(load_balancer *main, request *batch,
+									unsigned int n, bool batched,
+									server **prev)
+{
+	server *servers[n];
+	unsigned long switches = 0;
+
+	if (!main->ring_size)
+		return 0;
+
+	for (unsigned int i = 0; i < n; i++)
+		servers[i] = route(main, batch[i].doc_name);
+
+	if (batched)
+		qsort(servers, n, sizeof(*servers), compare_servers);
+
+	for (unsigned int i = 0; i < n; i++) {
+		switches += servers[i] != *prev;
+		*prev = servers[i];
+	}
+
+	return switches;
+}
+
+/*
+ * flush() - Forwards the requests of a batch, one by one when batch_size is
+ * 0, and frees the strings left.
+ */
+static void flush(load_balancer *main, request *batch, unsigned int *n,
+				  unsigned int batch_size)
+{
+	if (batch_size) {
+		loader_forward_batch(main, batch, NULL, *n);
+	} else {
+		for (unsigned int i = 0; i < *n; i++) {
+			response *res = loader_forward_request(main, &batch[i]);
+			PRINT_RESPONSE(res);
+		}
+	}
+
+	for (unsigned int i = 0; i < *n; i++) {
+		if (batch[i].type == EDIT_DOCUMENT) {
+			free(batch[i].doc_name);
+			blob_put(batch[i].doc_content);
+		}
+	}
+
+	*n = 0;
+}
+
+/*
+ * run() - Handles parsed requests in batches of batch_size requests (or
+ * one by one, when it is 0), like main does.
+ *
+ * @param switches: Gets the number of switches between servers, if not
+ *        NULL; they are counted apart from the timed runs.
+ */
+static void run(parsed_request *reqs, int requests_num, bool enable_vnodes,
+				unsigned int batch_size, unsigned long *switches)
+{
+	unsigned int capacity = batch_size ? batch_size : 1;
+	request *batch = malloc(capacity * sizeof(*batch));
+	DIE(!batch, "malloc batch");
+
+	load_balancer *main = init_load_balancer(enable_vnodes);
+	server *prev = NULL;
+	unsigned int n = 0;
+
+	for (int i = 0; i < requests_num; i++) {
+		parsed_request *req = &reqs[i];
+
+		if (req->type == ADD_SERVER || req->type == REMOVE_SERVER) {
+			if (switches)
+				*switches += count_switches(main, batch, n, batch_size,
+											&prev);
+			flush(main, batch, &n, batch_size);
+
+			if (req->type == ADD_SERVER)
+				loader_add_server(main, req->server_id, req->cache_size);
+			else
+				loader_remove_server(main, req->server_id);
+			continue;
+		}
+
+		batch[n].type = req->type;
+		if (req->type == GET_DOCUMENT) {
+			batch[n].doc_name = req->doc_name;
+			batch[n].doc_content = NULL;
+		} else {
+			batch[n].doc_name = strndup(req->doc_name, req->doc_name_length);
+			batch[n].doc_content = blob_create(req->doc_content,
+											   req->doc_content_length);
+		}
+
+		if (++n == capacity) {
+			if (switches)
+				*switches += count_switches(main, batch, n, batch_size,
+											&prev);
+			flush(main, batch, &n, batch_size);
+		}
+	}
+
+	if (switches)
+		*switches += count_switches(main, batch, n, batch_size, &prev);
+	flush(main, batch, &n, batch_size);
+
+	free_load_balancer(&main);
+	writer_flush(writer_stdout());
+	free(batch);
+}
+
+/*
+ * bench() - Times the requests of a file with every batch size.
+ */
+static void bench(const char *path, int counter, int out)
+{
+	unsigned int batch_sizes[] = {0, 16, 64, 256, 1024, 4096};
+
+	// The requests are parsed once; their strings stay in the mapping
+	reader_t *r = reader_open(path);
+	DIE(!r, "reader_open");
+
+	int requests_num;
+	bool enable_vnodes;
+	reader_header(r, &requests_num, &enable_vnodes);
+
+	parsed_request *reqs = malloc(requests_num * sizeof(*reqs));
+	DIE(!reqs, "malloc requests");
+
+	for (int i = 0; i < requests_num; i++)
+		DIE(!reader_next(r, &reqs[i]), "insufficient requests");
+
+	// Print the name of the file without its directories
+	const char *name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+
+	double one_by_one = 0;
+	for (unsigned int b = 0; b < sizeof(batch_sizes) / sizeof(*batch_sizes);
+		 b++) {
+		double best = 0;
+		long long misses = -1;
+
+		for (int round = 0; round < BENCH_ROUNDS; round++) {
+			if (counter >= 0) {
+				ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+				ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+			}
+
+			double start = now_ns();
+			run(reqs, requests_num, enable_vnodes, batch_sizes[b], NULL);
+			double elapsed = now_ns() - start;
+
+			if (counter >= 0) {
+				long long count;
+				ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+				if (read(counter, &count, sizeof(count)) == sizeof(count) &&
+					(misses < 0 || count < misses))
+					misses = count;
+			}
+
+			if (!round || elapsed < best)
+				best = elapsed;
+		}
+
+		unsigned long switches = 0;
+		run(reqs, requests_num, enable_vnodes, batch_sizes[b], &switches);
+
+		if (!batch_sizes[b])
+			one_by_one = best;
+
+		char batch[16], misses_str[24];
+		snprintf(batch, sizeof(batch), "%u", batch_sizes[b]);
+		if (misses < 0)
+			snprintf(misses_str, sizeof(misses_str), "n/a");
+		else
+			snprintf(misses_str, sizeof(misses_str), "%lld", misses);
+
+		dprintf(out, "%-12s %8s %10.1f %14.0f %8.2f %14s %10.3f\n", name,
+				batch_sizes[b] ? batch : "none", best / 1e6,
+				requests_num / (best / 1e9), one_by_one / best, misses_str,
+				(double)switches / requests_num);
+	}
+
+	free(reqs);
+	reader_close(&r);
+}
+
+int main(int argc, char **argv)
+{
+	const char *default_files[] = {"../in/test19.in", "../in/test20.in",
+								   "../in/test29.in", "../in/test30.in"};
+	const char **files = argc > 1 ? (const char **)argv + 1 : default_files;
+	int files_num = argc > 1 ? argc - 1 : 4;
+
+	int counter = open_cache_misses();
+
+	// The responses are not part of the benchmark, only their printing
+	int out = mute_stdout();
+
+	dprintf(out, "%-12s %8s %10s %14s %8s %14s %10s\n", "file", "batch", "ms",
+			"requests/s", "speedup", "cache misses", "switches");
+
+	for (int i = 0; i < files_num; i++)
+		bench(files[i], counter, out);
+
+	if (counter >= 0)
+		close(counter);
+	close(out);
+
+	return 0;
+}
@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures the containers the servers are built from on their own, in ns per
+// operation, so a change to one of them can be checked without running tema2:
+//
+//     ./bench_containers [--keys=N] [--key-len=N] [--value-size=N]
+//                        [--lru-capacity=N] [--warmup=N] [--reps=N]
+//                        [--filter=<prefix>] [--json]
+//
+// Every benchmark runs its operation once for each of the keys (in a random
+// order, for the lookups and removals), timing them in groups of
+// BENCH_GROUP; the structure is built again before every repetition, outside
+// of the timing. The first --warmup repetitions are not recorded, and the
+// percentiles are the ones of the groups of all the other repetitions.
+
+#include "../lru_cache.h"
+#include "../add/hashtable.h"
+#include "../add/linked_list.h"
+#include "../add/open_hashtable.h"
+#include "../add/queue.h"
+#include "bench.h"
+
+// Number of operations timed together, so reading the clock (about 20ns)
+// does not hide the cost of the fast ones
+#define BENCH_GROUP 64
+
+typedef struct bench_options {
+	unsigned int keys;
+	unsigned int key_len;
+	unsigned int value_size;
+	unsigned int lru_capacity;
+	unsigned int warmup;
+	unsigned int reps;
+	const char *filter;
+	bool json;
+} bench_options;
+
+// Everything the operations work on
+typedef struct bench_ctx {
+	const bench_options *opt;
+
+	// The keys, keys that are never added, and a random order of the keys
+	char **keys;
+	char **absent;
+	unsigned int *order;
+
+	// The value stored for every key, as bytes and as a blob
+	char *value;
+	char *blob;
+
+	hashtable_t *ht;
+	open_hashtable_t *oht;
+	lru_cache *lru;
+	queue_t *q;
+	ll_list_t *list;
+} bench_ctx;
+
+typedef struct container_bench {
+	const char *name;
+
+	// Builds the structure before every repetition (may be NULL)
+	void (*setup)(bench_ctx *ctx);
+
+	// The operation being measured, on the i-th key
+	void (*op)(bench_ctx *ctx, unsigned int i);
+
+	// Frees the structure after every repetition
+	void (*teardown)(bench_ctx *ctx);
+} container_bench;
+
+// State of the xorshift64* generator, so the runs do not depend on libc
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long rng_next(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * make_key() - Makes the key of an index, padded to key_len characters.
+ */
+static char *make_key(const char *prefix, unsigned int idx, unsigned int len)
+{
+	char *key = malloc(len + 1);
+	DIE(!key, "malloc key");
+
+	int printed = snprintf(key, len + 1, "%s_%u_", prefix, idx);
+	for (unsigned int i = printed; i < len; i++)
+		key[i] = 'a' + (idx + i) % 26;
+	key[len] = '\0';
+
+	return key;
+}
+
+/* The old chaining hashtable (add/hashtable.c) */
+
+static void ht_setup_empty(bench_ctx *ctx)
+{
+	ctx->ht = ht_create(ctx->opt->keys, hash_string, compare_strings);
+}
+
+static void ht_setup_full(bench_ctx *ctx)
+{
+	ht_setup_empty(ctx);
+
+	for (unsigned int i = 0; i < ctx->opt->keys; i++)
+		ht_put(ctx->ht, ctx->keys[i], ctx->opt->key_len + 1, ctx->value,
+			   ctx->opt->value_size);
+}
+
+static void ht_teardown(bench_ctx *ctx)
+{
+	ht_free(ctx->ht);
+}
+
+static void ht_op_put(bench_ctx *ctx, unsigned int i)
+{
+	ht_put(ctx->ht, ctx->keys[i], ctx->opt->key_len + 1, ctx->value,
+		   ctx->opt->value_size);
+}
+
+static void ht_op_get(bench_ctx *ctx, unsigned int i)
+{
+	DIE(!ht_get(ctx->ht, ctx->keys[ctx->order[i]]), "ht_get");
+}
+
+static void ht_op_get_miss(bench_ctx *ctx, unsigned int i)
+{
+	DIE(ht_get(ctx->ht, ctx->absent[i]), "ht_get");
+}
+
+static void ht_op_remove(bench_ctx *ctx, unsigned int i)
+{
+	ht_remove_entry(ctx->ht, ctx->keys[ctx->order[i]]);
+}
+
+/* The open addressing hashtable of the databases (add/open_hashtable.c) */
+
+static void oht_setup_empty(bench_ctx *ctx)
+{
+	ctx->oht = oht_create(0, hash_string, NULL, NULL);
+}
+
+static void oht_setup_full(bench_ctx *ctx)
+{
+	oht_setup_empty(ctx);
+
+	for (unsigned int i = 0; i < ctx->opt->keys; i++)
+		oht_put(ctx->oht, ctx->keys[i], ctx->opt->key_len + 1, ctx->value,
+				ctx->opt->value_size);
+}
+
+static void oht_teardown(bench_ctx *ctx)
+{
+	oht_free(ctx->oht);
+}
+
+static void oht_op_put(bench_ctx *ctx, unsigned int i)
+{
+	oht_put(ctx->oht, ctx->keys[i], ctx->opt->key_len + 1, ctx->value,
+			ctx->opt->value_size);
+}
+
+static void oht_op_get(bench_ctx *ctx, unsigned int i)
+{
+	DIE(!oht_get(ctx->oht, ctx->keys[ctx->order[i]]), "oht_get");
+}
+
+static void oht_op_get_miss(bench_ctx *ctx, unsigned int i)
+{
+	DIE(oht_get(ctx->oht, ctx->absent[i]), "oht_get");
+}
+
+static void oht_op_remove(bench_ctx *ctx, unsigned int i)
+{
+	oht_remove_entry(ctx->oht, ctx->keys[ctx->order[i]]);
+}
+
+/* The LRU cache (lru_cache.c) */
+
+static void lru_setup_all(bench_ctx *ctx)
+{
+	void *evicted;
+
+	// Big enough for all the keys, so every get hits
+	ctx->lru = init_lru_cache(ctx->opt->keys);
+	for (unsigned int i = 0; i < ctx->opt->keys; i++)
+		lru_cache_put(ctx->lru, ctx->keys[i], ctx->blob, &evicted);
+}
+
+static void lru_setup_full(bench_ctx *ctx)
+{
+	void *evicted;
+
+	// Filled with other keys, so every put of a key evicts one
+	ctx->lru = init_lru_cache(ctx->opt->lru_capacity);
+	for (unsigned int i = 0; i < ctx->opt->lru_capacity; i++)
+		lru_cache_put(ctx->lru, ctx->absent[i], ctx->blob, &evicted);
+}
+
+static void lru_teardown(bench_ctx *ctx)
+{
+	free_lru_cache(&ctx->lru);
+}
+
+static void lru_op_hit(bench_ctx *ctx, unsigned int i)
+{
+	DIE(!lru_cache_get(ctx->lru, ctx->keys[ctx->order[i]]), "lru_cache_get");
+}
+
+static void lru_op_miss(bench_ctx *ctx, unsigned int i)
+{
+	DIE(lru_cache_get(ctx->lru, ctx->absent[i]), "lru_cache_get");
+}
+
+static void lru_op_evict(bench_ctx *ctx, unsigned int i)
+{
+	void *evicted = NULL;
+
+	lru_cache_put(ctx->lru, ctx->keys[i], ctx->blob, &evicted);
+	DIE(!evicted, "lru_cache_put did not evict");
+}
+
+/* The task queue (add/queue.c) */
+
+static void q_setup_empty(bench_ctx *ctx)
+{
+	ctx->q = q_create(ctx->opt->value_size, 1);
+}
+
+static void q_setup_full(bench_ctx *ctx)
+{
+	q_setup_empty(ctx);
+
+	for (unsigned int i = 0; i < ctx->opt->keys; i++)
+		q_enqueue(ctx->q, ctx->value);
+}
+
+static void q_teardown(bench_ctx *ctx)
+{
+	q_free(ctx->q);
+}
+
+static void q_op_enqueue(bench_ctx *ctx, unsigned int i)
+{
+	(void)i;
+	q_enqueue(ctx->q, ctx->value);
+}
+
+static void q_op_dequeue(bench_ctx *ctx, unsigned int i)
+{
+	(void)i;
+	DIE(!q_front(ctx->q), "q_front");
+	q_dequeue(ctx->q);
+}
+
+/* The generic linked list (add/linked_list.c) */
+
+static void ll_setup_empty(bench_ctx *ctx)
+{
+	ctx->list = ll_create(ctx->opt->value_size);
+}
+
+static void ll_setup_full(bench_ctx *ctx)
+{
+	ll_setup_empty(ctx);
+
+	for (unsigned int i = 0; i < ctx->opt->keys; i++)
+		ll_add_nth_node(ctx->list, ctx->list->size, ctx->value);
+}
+
+static void ll_teardown(bench_ctx *ctx)
+{
+	ll_free(&ctx->list);
+}
+
+static void ll_op_push_back(bench_ctx *ctx, unsigned int i)
+{
+	(void)i;
+	ll_add_nth_node(ctx->list, ctx->list->size, ctx->value);
+}
+
+static void ll_op_pop_front(bench_ctx *ctx, unsigned int i)
+{
+	(void)i;
+	ll_node_t *node = ll_remove_nth_node(ctx->list, 0);
+
+	free(node->data);
+	free(node);
+}
+
+static const container_bench benches[] = {
+	{"ht_put", ht_setup_empty, ht_op_put, ht_teardown},
+	{"ht_get", ht_setup_full, ht_op_get, ht_teardown},
+	{"ht_get_miss", ht_setup_full, ht_op_get_miss, ht_teardown},
+	{"ht_remove_entry", ht_setup_full, ht_op_remove, ht_teardown},
+	{"oht_put", oht_setup_empty, oht_op_put, oht_teardown},
+	{"oht_get", oht_setup_full, oht_op_get, oht_teardown},
+	{"oht_get_miss", oht_setup_full, oht_op_get_miss, oht_teardown},
+	{"oht_remove_entry", oht_setup_full, oht_op_remove, oht_teardown},
+	{"lru_hit", lru_setup_all, lru_op_hit, lru_teardown},
+	{"lru_miss", lru_setup_all, lru_op_miss, lru_teardown},
+	{"lru_evict", lru_setup_full, lru_op_evict, lru_teardown},
+	{"q_enqueue", q_setup_empty, q_op_enqueue, q_teardown},
+	{"q_dequeue", q_setup_full, q_op_dequeue, q_teardown},
+	{"ll_push_back", ll_setup_empty, ll_op_push_back, ll_teardown},
+	{"ll_pop_front", ll_setup_full, ll_op_pop_front, ll_teardown},
+};
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * percentile() - Gets a percentile of sorted samples (the nearest rank).
+ */
+static double percentile(const double *sorted, unsigned int num, double p)
+{
+	unsigned int rank = p / 100 * num;
+
+	return sorted[rank < num ? rank : num - 1];
+}
+
+/*
+ * run_bench() - Runs the repetitions of a benchmark and prints the
+ * distribution of its ns per operation.
+ */
+static void run_bench(const container_bench *b, bench_ctx *ctx)
+{
+	const bench_options *opt = ctx->opt;
+	unsigned int groups = (opt->keys + BENCH_GROUP - 1) / BENCH_GROUP;
+
+	double *samples = malloc((size_t)groups * opt->reps * sizeof(*samples));
+	DIE(!samples, "malloc samples");
+	unsigned int samples_num = 0;
+	double total_ns = 0;
+
+	for (unsigned int rep = 0; rep < opt->warmup + opt->reps; rep++) {
+		bool recorded = rep >= opt->warmup;
+
+		if (b->setup)
+			b->setup(ctx);
+
+		for (unsigned int start = 0; start < opt->keys; start += BENCH_GROUP) {
+			unsigned int end = start + BENCH_GROUP < opt->keys ?
+							   start + BENCH_GROUP : opt->keys;
+
+			double begin = now_ns();
+			for (unsigned int i = start; i < end; i++)
+				b->op(ctx, i);
+			double elapsed = now_ns() - begin;
+
+			if (recorded) {
+				samples[samples_num++] = elapsed / (end - start);
+				total_ns += elapsed;
+			}
+		}
+
+		b->teardown(ctx);
+	}
+
+	qsort(samples, samples_num, sizeof(*samples), compare_doubles);
+
+	double mean = total_ns / ((double)opt->keys * opt->reps);
+	double p50 = percentile(samples, samples_num, 50);
+	double p90 = percentile(samples, samples_num, 90);
+	double p99 = percentile(samples, samples_num, 99);
+	double max = samples[samples_num - 1];
+
+	if (opt->json)
+		printf("{\"bench\": \"%s\", \"keys\": %u, \"key_len\": %u, "
+			   "\"value_size\": %u, \"reps\": %u, \"mean_ns\": %.2f, "
+			   "\"p50_ns\": %.2f, \"p90_ns\": %.2f, \"p99_ns\": %.2f, "
+			   "\"max_ns\": %.2f}\n", b->name, opt->keys, opt->key_len,
+			   opt->value_size, opt->reps, mean, p50, p90, p99, max);
+	else
+		printf("%-18s %10.1f %10.1f %10.1f %10.1f %10.1f\n", b->name, mean,
+			   p50, p90, p99, max);
+
+	free(samples);
+}
+
+/*
+ * parse_option() - Parses an option of the command line.
+ *
+ * @return bool - False if the option is unknown.
+ */
+static bool parse_option(bench_options *opt, const char *arg)
+{
+	const char *value = strchr(arg, '=');
+	value = value ? value + 1 : "";
+
+	if (!strncmp(arg, "--keys=", 7))
+		opt->keys = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--key-len=", 10))
+		opt->key_len = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--value-size=", 13))
+		opt->value_size = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--lru-capacity=", 15))
+		opt->lru_capacity = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--warmup=", 9))
+		opt->warmup = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--reps=", 7))
+		opt->reps = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--filter=", 9))
+		opt->filter = value;
+	else if (!strcmp(arg, "--json"))
+		opt->json = true;
+	else
+		return false;
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	bench_options opt = {
+		.keys = 100000,
+		.key_len = 16,
+		.value_size = 64,
+		.lru_capacity = 0,
+		.warmup = 2,
+		.reps = 10,
+		.filter = "",
+		.json = false,
+	};
+
+	for (int i = 1; i < argc; i++)
+		DIE(!parse_option(&opt, argv[i]), "unknown option");
+
+	DIE(!opt.keys || !opt.reps || !opt.value_size, "invalid options");
+
+	// By default, the LRU cache holds 1024 keys, or all of them if fewer
+	if (!opt.lru_capacity)
+		opt.lru_capacity = opt.keys < 1024 ? opt.keys : 1024;
+	DIE(opt.lru_capacity > opt.keys,
+		"the LRU capacity must not exceed the number of keys");
+
+	// Leave room for the prefix and the index, which keep the keys unique
+	if (opt.key_len < 16)
+		opt.key_len = 16;
+
+	bench_ctx ctx = {.opt = &opt};
+
+	ctx.keys = malloc(opt.keys * sizeof(*ctx.keys));
+	ctx.absent = malloc(opt.keys * sizeof(*ctx.absent));
+	ctx.order = malloc(opt.keys * sizeof(*ctx.order));
+	ctx.value = malloc(opt.value_size);
+	DIE(!ctx.keys || !ctx.absent || !ctx.order || !ctx.value, "malloc");
+
+	for (unsigned int i = 0; i < opt.keys; i++) {
+		ctx.keys[i] = make_key("key", i, opt.key_len);
+		ctx.absent[i] = make_key("absent", i, opt.key_len);
+		ctx.order[i] = i;
+	}
+
+	// Shuffle the order of the lookups and removals (Fisher-Yates)
+	for (unsigned int i = opt.keys - 1; i > 0; i--) {
+		unsigned int j = rng_next() % (i + 1);
+		unsigned int tmp = ctx.order[i];
+
+		ctx.order[i] = ctx.order[j];
+		ctx.order[j] = tmp;
+	}
+
+	memset(ctx.value, 'v', opt.value_size);
+	ctx.blob = blob_create(ctx.value, opt.value_size);
+
+	if (!opt.json) {
+		printf("%u keys of %u bytes, values of %u bytes, LRU capacity %u, "
+			   "%u warmup + %u repetitions\n", opt.keys, opt.key_len,
+			   opt.value_size, opt.lru_capacity, opt.warmup, opt.reps);
+		printf("%-18s %10s %10s %10s %10s %10s\n", "ns/op", "mean", "p50",
+			   "p90", "p99", "max");
+	}
+
+	for (unsigned int i = 0; i < sizeof(benches) / sizeof(*benches); i++)
+		if (!strncmp(benches[i].name, opt.filter, strlen(opt.filter)))
+			run_bench(&benches[i], &ctx);
+
+	for (unsigned int i = 0; i < opt.keys; i++) {
+		free(ctx.keys[i]);
+		free(ctx.absent[i]);
+	}
+	free(ctx.keys);
+	free(ctx.absent);
+	free(ctx.order);
+	free(ctx.value);
+	blob_put(ctx.blob);
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures the cost of recording the latencies (--latency), timing one in
+// every N requests and task queue executions, for a few values of N:
+//
+//     ./bench_latency [input file] [rounds]
+//
+// First, the cost of recording one operation on its own (starting and
+// recording it, in a loop), which is steady enough to be compared to the
+// cost of a request; then the requests of an input file are handled with
+// every setting, and without recording them. The file is parsed beforehand,
+// so only the routing, the servers and the printing of the responses are
+// timed. The rounds of all the settings are interleaved, so a slower period
+// of the machine slows all of them alike, and the best time of every
+// setting is reported.
+
+#include <unistd.h>
+
+#include "../load_balancer.h"
+#include "../add/reader.h"
+#include "bench.h"
+
+#define BENCH_ROUNDS 15
+#define BENCH_OPS 10000000
+
+// One in this many requests is timed; 0 for no recording
+static const unsigned int samples[] = {0, 64, LATENCY_SAMPLE_DEFAULT, 4, 1};
+
+#define SETTINGS (sizeof(samples) / sizeof(*samples))
+
+/*
+ * record_cost() - Gets the cost of starting and recording an operation.
+ *
+ * @return double - The time per operation, in ns.
+ */
+static double record_cost(unsigned int sample_every)
+{
+	latency_t *lat = sample_every ? latency_create(sample_every) : NULL;
+	double start = now_ns();
+
+	for (unsigned int i = 0; i < BENCH_OPS; i++)
+		latency_record(lat, LATENCY_GET_HIT, latency_start(lat));
+
+	double ns = (now_ns() - start) / BENCH_OPS;
+	if (lat)
+		latency_free(&lat);
+
+	return ns;
+}
+
+/*
+ * run() - Handles parsed requests the way main does, recording the
+ * latencies if sample_every is not 0.
+ *
+ * @return double - The time it took, in ns.
+ */
+static double run(parsed_request *reqs, int requests_num, bool enable_vnodes,
+				  unsigned int sample_every)
+{
+	double start = now_ns();
+
+	load_balancer *main = init_load_balancer(enable_vnodes);
+	if (sample_every)
+		loader_enable_latency(main, sample_every);
+
+	for (int i = 0; i < requests_num; i++) {
+		parsed_request *req = &reqs[i];
+
+		if (req->type == ADD_SERVER) {
+			loader_add_server(main, req->server_id, req->cache_size);
+		} else if (req->type == REMOVE_SERVER) {
+			loader_remove_server(main, req->server_id);
+		} else if (req->type == GET_STATS) {
+			loader_handle_stats(main);
+		} else if (req->type == GET_DOCUMENT) {
+			request get = {
+				.type = req->type,
+				.doc_name = req->doc_name,
+			};
+
+			response *res = loader_forward_request(main, &get);
+			PRINT_RESPONSE(res);
+		} else {
+			request edit = {
+				.type = req->type,
+				.doc_name = strndup(req->doc_name, req->doc_name_length),
+				.doc_content = blob_create(req->doc_content,
+										   req->doc_content_length),
+			};
+
+			response *res = loader_forward_request(main, &edit);
+			PRINT_RESPONSE(res);
+
+			free(edit.doc_name);
+			blob_put(edit.doc_content);
+		}
+	}
+
+	free_load_balancer(&main);
+	writer_flush(writer_stdout());
+
+	return now_ns() - start;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "../in/test30.in";
+	int rounds = argc > 2 ? atoi(argv[2]) : BENCH_ROUNDS;
+	DIE(rounds <= 0, "the number of rounds must be positive");
+
+	// The requests are parsed once; their strings stay in the mapping
+	reader_t *r = reader_open(path);
+	DIE(!r, "reader_open");
+
+	int requests_num;
+	bool enable_vnodes;
+	reader_header(r, &requests_num, &enable_vnodes);
+
+	parsed_request *reqs = malloc(requests_num * sizeof(*reqs));
+	DIE(!reqs, "malloc requests");
+
+	for (int i = 0; i < requests_num; i++)
+		DIE(!reader_next(r, &reqs[i]), "insufficient requests");
+
+	// The responses are not part of the benchmark, only their printing
+	int out = mute_stdout();
+
+	double cost[SETTINGS], best[SETTINGS];
+	for (int round = 0; round < rounds; round++) {
+		for (unsigned int i = 0; i < SETTINGS; i++) {
+			double ns = record_cost(samples[i]);
+			if (!round || ns < cost[i])
+				cost[i] = ns;
+		}
+	}
+
+	for (int round = 0; round < rounds; round++) {
+		for (unsigned int i = 0; i < SETTINGS; i++) {
+			double ns = run(reqs, requests_num, enable_vnodes, samples[i]);
+			if (!round || ns < best[i])
+				best[i] = ns;
+		}
+	}
+
+	dprintf(out, "%s: %d requests, best of %d rounds\n", path, requests_num,
+			rounds);
+	dprintf(out, "%10s %10s %10s %12s %10s\n", "timed", "ns/record", "ms",
+			"ns/request", "overhead");
+
+	for (unsigned int i = 0; i < SETTINGS; i++) {
+		char timed[16] = "none";
+		if (samples[i])
+			snprintf(timed, sizeof(timed), "1 in %u", samples[i]);
+
+		dprintf(out, "%10s %10.1f %10.1f %12.1f %9.1f%%\n", timed,
+				cost[i] - cost[0], best[i] / 1e6, best[i] / requests_num,
+				100 * (best[i] / best[0] - 1));
+	}
+
+	free(reqs);
+	reader_close(&r);
+	close(out);
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures how fast the input files are parsed, without handling the
+// requests: with the fgets parser, with the mapped reader which replaced it
+// and from compiled traces; all the throughputs are in MB of text input
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../load_balancer.h"
+#include "../add/reader.h"
+#include "../add/trace.h"
+#include "bench.h"
+
+#define BENCH_ROUNDS 20
+
+/*
+ * parse_mapped() - Parses a file with the mapped reader.
+ *
+ * @return unsigned int - The number of requests read.
+ */
+static unsigned int parse_mapped(const char *path)
+{
+	reader_t *r = reader_open(path);
+	DIE(!r, "reader_open");
+
+	int requests_num;
+	bool enable_vnodes;
+	reader_header(r, &requests_num, &enable_vnodes);
+
+	parsed_request req;
+	unsigned int requests = 0;
+	while (reader_next(r, &req))
+		requests++;
+
+	reader_close(&r);
+	return requests;
+}
+
+/*
+ * find_quotes() - Finds the first two quotes of a string, like the
+ * read_quoted_string function of the fgets parser.
+ */
+static void find_quotes(char *buffer, int *start, int *end)
+{
+	*end = -1;
+
+	for (int i = 0; buffer[i] != '\0'; ++i) {
+		if (buffer[i] != '"')
+			continue;
+
+		if (*start == -1) {
+			*start = i;
+		} else {
+			*end = i;
+			break;
+		}
+	}
+}
+
+/*
+ * parse_stdio() - Parses a file the way main did before the mapped reader:
+ * with fgets, copying the name and the content of every request.
+ *
+ * @return unsigned int - The number of requests read.
+ */
+static unsigned int parse_stdio(const char *path)
+{
+	static char buffer[REQUEST_LENGTH + 1];
+	unsigned int requests = 0;
+
+	FILE *in = fopen(path, "rt");
+	DIE(!in, "fopen");
+	DIE(!fgets(buffer, REQUEST_LENGTH + 1, in), "fgets");
+
+	while (fgets(buffer, REQUEST_LENGTH + 1, in)) {
+		request_type type = get_request_type(buffer);
+		int start = -1, end = -1;
+		requests++;
+
+		if (type == ADD_SERVER || type == REMOVE_SERVER)
+			continue;
+
+		find_quotes(buffer, &start, &end);
+		char *name = strndup(buffer + start + 1, end - start - 1);
+
+		if (type == EDIT_DOCUMENT) {
+			char *rest = buffer + end + 1;
+			start = -1;
+			find_quotes(rest, &start, &end);
+
+			char *content;
+			if (end == -1)
+				content = blob_create(rest + start + 1,
+									  strlen(rest + start + 1));
+			else
+				content = blob_create(rest + start + 1, end - start - 1);
+
+			// The content may go on over the following lines
+			while (end == -1) {
+				DIE(!fgets(buffer, DOC_CONTENT_LENGTH + 1, in), "fgets");
+				find_quotes(buffer, &start, &end);
+				content = blob_append(content, buffer, end == -1 ?
+									  strlen(buffer) : (unsigned int)end);
+			}
+
+			blob_put(content);
+		}
+
+		free(name);
+	}
+
+	fclose(in);
+	return requests;
+}
+
+/*
+ * compile_trace() - Compiles an input file into a temporary trace.
+ */
+static void compile_trace(const char *path, char *trace_path)
+{
+	int fd = mkstemp(trace_path);
+	DIE(fd < 0, "mkstemp");
+	close(fd);
+
+	reader_t *in = reader_open(path);
+	DIE(!in, "reader_open");
+
+	int requests_num;
+	bool enable_vnodes;
+	reader_header(in, &requests_num, &enable_vnodes);
+
+	writer_t *out = writer_open(trace_path);
+	DIE(!out, "writer_open");
+
+	trace_compile(in, requests_num, enable_vnodes, out);
+
+	writer_close(&out);
+	reader_close(&in);
+}
+
+/*
+ * bench() - Parses a file BENCH_ROUNDS times.
+ *
+ * @return double - The best throughput, in MB/s.
+ */
+static double bench(unsigned int (*parse)(const char *), const char *path,
+					size_t size, unsigned int *requests)
+{
+	double best = 0;
+
+	for (int i = 0; i < BENCH_ROUNDS; i++) {
+		double start = now_ns();
+		*requests = parse(path);
+		double elapsed = now_ns() - start;
+
+		double mbps = size / 1e6 / (elapsed / 1e9);
+		if (mbps > best)
+			best = mbps;
+	}
+
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	char *default_files[] = {"../in/test20.in", "../in/test30.in"};
+	char **files = argc > 1 ? argv + 1 : default_files;
+	int file_count = argc > 1 ? argc - 1 : 2;
+
+	printf("%-18s %10s %10s %14s %14s %14s\n", "file", "MB", "requests",
+		   "fgets MB/s", "mapped MB/s", "trace MB/s");
+
+	for (int i = 0; i < file_count; i++) {
+		struct stat st;
+		DIE(stat(files[i], &st) < 0, "stat");
+
+		unsigned int stdio_requests, mapped_requests, trace_requests;
+		double stdio_mbps = bench(parse_stdio, files[i], st.st_size,
+								  &stdio_requests);
+		double mapped_mbps = bench(parse_mapped, files[i], st.st_size,
+								   &mapped_requests);
+
+		// The trace is read by the same reader, which recognizes it
+		char trace_path[] = "/tmp/bench_parse_XXXXXX";
+		compile_trace(files[i], trace_path);
+		double trace_mbps = bench(parse_mapped, trace_path, st.st_size,
+								  &trace_requests);
+		unlink(trace_path);
+
+		DIE(stdio_requests != mapped_requests ||
+			mapped_requests != trace_requests, "different requests");
+
+		// Print the name of the file without its directories
+		char *name = strrchr(files[i], '/');
+		printf("%-18s %10.2f %10u %14.1f %14.1f %14.1f\n",
+			   name ? name + 1 : files[i], st.st_size / 1e6, mapped_requests,
+			   stdio_mbps, mapped_mbps, trace_mbps);
+	}
+
+	return 0;
+}
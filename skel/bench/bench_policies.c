@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Compares the replacement policies of the caches: every trace is handled
+// with every policy, and the hit ratio of the GETs (over the whole cluster,
+// including the servers removed on the way) is reported with the throughput:
+//
+//     ./bench_policies [--rounds=N] [--no-generated] [--no-corpus] [--json]
+//                      [input files...]
+//
+// The traces are Zipf workloads made by gen_workload, one of them mixed with
+// scans, and the input files of the tests, handled together as one corpus
+// (their caches are small, so they are too short to compare on their own);
+// input files given on the command line are reported one by one instead.
+// The requests are parsed beforehand, and the best time of the rounds is
+// reported. It is run from skel/, after "make bench".
+
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../load_balancer.h"
+#include "../add/reader.h"
+#include "bench.h"
+
+#define BENCH_ROUNDS 3
+#define BENCH_MAX_ARGS 8
+
+typedef struct workload {
+	const char *name;
+	const char *args[BENCH_MAX_ARGS];
+} workload;
+
+// The synthetic workloads, given as options of gen_workload; the caches are
+// small next to the 10000 documents, so the policies make a difference
+static const workload workloads[] = {
+	{"zipf-0.8", {"--zipf=0.8", "--get-ratio=0.9"}},
+	{"zipf-0.99", {"--zipf=0.99", "--get-ratio=0.9"}},
+	{"zipf-1.2", {"--zipf=1.2", "--get-ratio=0.9"}},
+	{"zipf-0.99-write-heavy", {"--zipf=0.99", "--get-ratio=0.5"}},
+	{"zipf-0.99-scan", {"--zipf=0.99", "--get-ratio=0.9", "--scan=0.3"}},
+};
+
+static const cache_policy *policies[] = {
+	&policy_lru, &policy_clock, &policy_2q, &policy_arc, &policy_tinylfu,
+};
+
+// The requests of an input file, parsed
+typedef struct trace {
+	reader_t *reader;
+	parsed_request *reqs;
+	int requests_num;
+	bool enable_vnodes;
+} trace;
+
+// The result of handling one or more traces with a policy
+typedef struct policy_result {
+	unsigned long requests;
+	unsigned long hits, misses;
+	double ns;
+} policy_result;
+
+/*
+ * load_trace() - Parses the requests of an input file; their strings stay in
+ * the mapping of the file.
+ */
+static void load_trace(trace *t, const char *path)
+{
+	t->reader = reader_open(path);
+	DIE(!t->reader, "reader_open");
+
+	reader_header(t->reader, &t->requests_num, &t->enable_vnodes);
+
+	t->reqs = malloc(t->requests_num * sizeof(*t->reqs));
+	DIE(!t->reqs, "malloc requests");
+
+	for (int i = 0; i < t->requests_num; i++)
+		DIE(!reader_next(t->reader, &t->reqs[i]), "insufficient requests");
+}
+
+static void free_trace(trace *t)
+{
+	free(t->reqs);
+	reader_close(&t->reader);
+}
+
+/*
+ * cluster_hits() - Adds the hits and misses of the caches of all the servers,
+ * including the removed ones, to a result.
+ */
+static void cluster_hits(load_balancer *main, policy_result *res)
+{
+	res->hits += main->stats.removed_cache.hits;
+	res->misses += main->stats.removed_cache.misses;
+
+	// Every server is counted once, through its first label
+	for (unsigned int i = 0; i < main->ring_size; i++) {
+		if (main->ring[i].label > MAX_SERVERS)
+			continue;
+
+		res->hits += main->ring[i].s->cache->stats.hits;
+		res->misses += main->ring[i].s->cache->stats.misses;
+	}
+}
+
+/*
+ * replay() - Handles the requests of a trace the way main does.
+ */
+static void replay(const trace *t, load_balancer *main)
+{
+	for (int i = 0; i < t->requests_num; i++) {
+		parsed_request *req = &t->reqs[i];
+
+		if (req->type == ADD_SERVER) {
+			loader_add_server(main, req->server_id, req->cache_size);
+		} else if (req->type == REMOVE_SERVER) {
+			loader_remove_server(main, req->server_id);
+		} else if (req->type == GET_STATS) {
+			loader_handle_stats(main);
+		} else if (req->type == GET_DOCUMENT) {
+			request get = {
+				.type = req->type,
+				.doc_name = req->doc_name,
+			};
+
+			response *res = loader_forward_request(main, &get);
+			PRINT_RESPONSE(res);
+		} else {
+			request edit = {
+				.type = req->type,
+				.doc_name = strndup(req->doc_name, req->doc_name_length),
+				.doc_content = blob_create(req->doc_content,
+										   req->doc_content_length),
+			};
+
+			response *res = loader_forward_request(main, &edit);
+			PRINT_RESPONSE(res);
+
+			free(edit.doc_name);
+			blob_put(edit.doc_content);
+		}
+	}
+}
+
+/*
+ * run() - Handles traces with a policy, keeping the best time of the rounds;
+ * the hits and misses are the same in every round.
+ */
+static policy_result run(const trace *traces, unsigned int traces_num,
+						 const cache_policy *policy, int rounds)
+{
+	policy_result res = {0};
+
+	for (int round = 0; round < rounds; round++) {
+		policy_result cur = {0};
+		double start = now_ns();
+
+		for (unsigned int i = 0; i < traces_num; i++) {
+			load_balancer *main = init_load_balancer(traces[i].enable_vnodes);
+			main->cache_policy = policy;
+
+			replay(&traces[i], main);
+
+			cur.requests += traces[i].requests_num;
+			cluster_hits(main, &cur);
+			free_load_balancer(&main);
+		}
+		writer_flush(writer_stdout());
+
+		cur.ns = now_ns() - start;
+		if (!round || cur.ns < res.ns)
+			res = cur;
+	}
+
+	return res;
+}
+
+/*
+ * report() - Prints the results of all the policies on some traces.
+ */
+static void report(int out, const char *name, const trace *traces,
+				   unsigned int traces_num, int rounds, bool json)
+{
+	for (unsigned int p = 0; p < sizeof(policies) / sizeof(*policies); p++) {
+		policy_result res = run(traces, traces_num, policies[p], rounds);
+		unsigned long gets = res.hits + res.misses;
+		double ratio = gets ? 100.0 * res.hits / gets : 0;
+
+		if (json)
+			dprintf(out, "{\"trace\": \"%s\", \"policy\": \"%s\", "
+					"\"requests\": %lu, \"hits\": %lu, \"misses\": %lu, "
+					"\"hit_ratio\": %.4f, \"ms\": %.2f, "
+					"\"requests_per_s\": %.0f}\n", name, policies[p]->name,
+					res.requests, res.hits, res.misses, ratio / 100,
+					res.ns / 1e6, res.requests / (res.ns / 1e9));
+		else
+			dprintf(out, "%-22s %-8s %8.2f %10lu %10lu %10.1f %12.0f\n",
+					name, policies[p]->name, ratio, res.hits, res.misses,
+					res.ns / 1e6, res.requests / (res.ns / 1e9));
+	}
+}
+
+/*
+ * generate() - Generates the input file of a synthetic workload.
+ */
+static void generate(const workload *w, const char *path)
+{
+	char *argv[BENCH_MAX_ARGS + 2] = {"./gen_workload"};
+	int argc = 1;
+
+	for (int i = 0; i < BENCH_MAX_ARGS && w->args[i]; i++)
+		argv[argc++] = (char *)w->args[i];
+	argv[argc] = NULL;
+
+	pid_t pid = fork();
+	DIE(pid < 0, "fork");
+
+	if (!pid) {
+		int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0)
+			_exit(127);
+		close(fd);
+
+		execv(argv[0], argv);
+		_exit(127);
+	}
+
+	int status;
+	DIE(waitpid(pid, &status, 0) < 0, "waitpid");
+	DIE(!WIFEXITED(status) || WEXITSTATUS(status), "gen_workload");
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = BENCH_ROUNDS;
+	bool generated = true, corpus = true, json = false;
+	int files_from = argc;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strncmp(argv[i], "--rounds=", 9)) {
+			rounds = atoi(argv[i] + 9);
+		} else if (!strcmp(argv[i], "--no-generated")) {
+			generated = false;
+		} else if (!strcmp(argv[i], "--no-corpus")) {
+			corpus = false;
+		} else if (!strcmp(argv[i], "--json")) {
+			json = true;
+		} else if (argv[i][0] != '-') {
+			files_from = i;
+			break;
+		} else {
+			DIE(1, "unknown option");
+		}
+	}
+	DIE(rounds <= 0, "the number of rounds must be positive");
+
+	// The responses are not part of the benchmark, only their printing
+	int out = mute_stdout();
+
+	if (!json)
+		dprintf(out, "%-22s %-8s %8s %10s %10s %10s %12s\n", "trace",
+				"policy", "hit%", "hits", "misses", "ms", "requests/s");
+
+	// The input files given on the command line, one by one
+	for (int i = files_from; i < argc; i++) {
+		trace t;
+		load_trace(&t, argv[i]);
+		report(out, argv[i], &t, 1, rounds, json);
+		free_trace(&t);
+	}
+
+	char dir[] = "/tmp/policies_XXXXXX";
+	DIE(generated && !mkdtemp(dir), "mkdtemp");
+
+	unsigned int workloads_num = sizeof(workloads) / sizeof(*workloads);
+	for (unsigned int i = 0; generated && i < workloads_num; i++) {
+		char input[PATH_MAX];
+		snprintf(input, sizeof(input), "%s/%s.in", dir, workloads[i].name);
+		generate(&workloads[i], input);
+
+		trace t;
+		load_trace(&t, input);
+		report(out, workloads[i].name, &t, 1, rounds, json);
+		free_trace(&t);
+
+		unlink(input);
+	}
+
+	if (generated)
+		rmdir(dir);
+
+	// The input files of the tests, together
+	glob_t files = {0};
+	if (corpus && files_from == argc &&
+		!glob("../in/test*.in", 0, NULL, &files)) {
+		trace *traces = malloc(files.gl_pathc * sizeof(*traces));
+		DIE(!traces, "malloc traces");
+
+		for (size_t i = 0; i < files.gl_pathc; i++)
+			load_trace(&traces[i], files.gl_pathv[i]);
+
+		report(out, "corpus", traces, files.gl_pathc, rounds, json);
+
+		for (size_t i = 0; i < files.gl_pathc; i++)
+			free_trace(&traces[i]);
+		free(traces);
+	}
+	globfree(&files);
+
+	close(out);
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures the cost of adding a server to a loaded cluster as the number of
+// stored documents grows; only the documents taken over should matter
+
+#include <unistd.h>
+
+#include "../load_balancer.h"
+#include "bench.h"
+
+#define BENCH_SERVERS 8
+#define BENCH_ADDED 8
+#define BENCH_CACHE 64
+
+/*
+ * load_documents() - Stores docs documents on the servers, through EDITs
+ * followed by GETs, which execute the queues.
+ */
+static void load_documents(load_balancer *main, unsigned int docs)
+{
+	char name[DOC_NAME_LENGTH];
+
+	for (unsigned int i = 0; i < docs; i++) {
+		snprintf(name, sizeof(name), "bench_doc_%u.txt", i);
+
+		request edit = {
+			.type = EDIT_DOCUMENT,
+			.doc_name = strdup(name),
+			.doc_content = blob_create(name, strlen(name)),
+		};
+		loader_forward_request(main, &edit);
+		free(edit.doc_name);
+		blob_put(edit.doc_content);
+
+		request get = {
+			.type = GET_DOCUMENT,
+			.doc_name = name,
+		};
+		loader_forward_request(main, &get);
+	}
+}
+
+int main(void)
+{
+	unsigned int doc_counts[] = {10000, 100000, 1000000};
+
+	// The responses of the executed queues are not part of the benchmark
+	int out = mute_stdout();
+
+	dprintf(out, "%10s %10s %16s %16s\n", "documents", "servers",
+			"moved/add", "us/add");
+
+	for (unsigned int c = 0; c < sizeof(doc_counts) / sizeof(*doc_counts);
+		 c++) {
+		load_balancer *main = init_load_balancer(false);
+
+		for (unsigned int i = 0; i < BENCH_SERVERS; i++)
+			loader_add_server(main, i * 1000, BENCH_CACHE);
+
+		load_documents(main, doc_counts[c]);
+		fflush(stdout);
+
+		// Add servers one at a time, counting the documents they take over
+		unsigned long moved = 0;
+		double elapsed = 0;
+		for (unsigned int i = 0; i < BENCH_ADDED; i++) {
+			int id = i * 1000 + 500;
+
+			double start = now_ns();
+			loader_add_server(main, id, BENCH_CACHE);
+			elapsed += now_ns() - start;
+
+			for (unsigned int j = 0; j < main->ring_size; j++)
+				if (main->ring[j].label == id)
+					moved += oht_get_size(main->ring[j].s->db);
+		}
+
+		dprintf(out, "%10u %10u %16lu %16.1f\n", doc_counts[c],
+				BENCH_SERVERS + BENCH_ADDED, moved / BENCH_ADDED,
+				elapsed / BENCH_ADDED / 1e3);
+
+		free_load_balancer(&main);
+	}
+
+	close(out);
+	return 0;
+}
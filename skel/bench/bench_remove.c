@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures the latency of removing a server as the number of documents it
+// stores grows
+
+#include <unistd.h>
+
+#include "../load_balancer.h"
+#include "bench.h"
+
+#define BENCH_CACHE 64
+
+/*
+ * load_documents() - Stores docs documents on the servers, through EDITs
+ * followed by GETs, which execute the queues.
+ */
+static void load_documents(load_balancer *main, unsigned int docs)
+{
+	char name[DOC_NAME_LENGTH];
+
+	for (unsigned int i = 0; i < docs; i++) {
+		snprintf(name, sizeof(name), "bench_doc_%u.txt", i);
+
+		request edit = {
+			.type = EDIT_DOCUMENT,
+			.doc_name = strdup(name),
+			.doc_content = blob_create(name, strlen(name)),
+		};
+		loader_forward_request(main, &edit);
+		free(edit.doc_name);
+		blob_put(edit.doc_content);
+
+		request get = {
+			.type = GET_DOCUMENT,
+			.doc_name = name,
+		};
+		loader_forward_request(main, &get);
+	}
+}
+
+int main(void)
+{
+	unsigned int doc_counts[] = {10000, 50000, 100000, 500000, 1000000};
+
+	// The responses of the executed queues are not part of the benchmark
+	int out = mute_stdout();
+
+	dprintf(out, "%10s %10s %12s %12s\n", "documents", "removed",
+			"us/remove", "ns/document");
+
+	for (unsigned int c = 0; c < sizeof(doc_counts) / sizeof(*doc_counts);
+		 c++) {
+		// Two servers share the documents, then one of them is removed
+		load_balancer *main = init_load_balancer(false);
+		loader_add_server(main, 1, BENCH_CACHE);
+		loader_add_server(main, 2, BENCH_CACHE);
+
+		load_documents(main, doc_counts[c]);
+		fflush(stdout);
+
+		unsigned int removed = 0;
+		for (unsigned int j = 0; j < main->ring_size; j++)
+			if (main->ring[j].label == 1)
+				removed = oht_get_size(main->ring[j].s->db);
+
+		double start = now_ns();
+		loader_remove_server(main, 1);
+		double elapsed = now_ns() - start;
+
+		dprintf(out, "%10u %10u %12.1f %12.1f\n", doc_counts[c], removed,
+				elapsed / 1e3, removed ? elapsed / removed : 0);
+
+		free_load_balancer(&main);
+	}
+
+	close(out);
+	return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures the cost of routing a request through the hash ring as the number
+// of servers grows; the cost per request should stay (almost) flat
+
+#include "../load_balancer.h"
+#include "bench.h"
+
+#define BENCH_REQUESTS 200000
+#define BENCH_DOCS 4096
+
+int main(void)
+{
+	unsigned int server_counts[] = {1, 10, 100, 1000, 10000, 50000};
+	static char names[BENCH_DOCS][DOC_NAME_LENGTH];
+
+	// Generate the names of the (missing) documents that will be requested
+	for (int i = 0; i < BENCH_DOCS; i++)
+		snprintf(names[i], DOC_NAME_LENGTH, "bench_doc_%d.txt", i);
+
+	printf("%10s %16s\n", "servers", "ns/request");
+
+	for (unsigned int c = 0;
+		 c < sizeof(server_counts) / sizeof(*server_counts); c++) {
+		load_balancer *main = init_load_balancer(false);
+
+		// Spread the server ids over the whole id space
+		for (unsigned int i = 0; i < server_counts[c]; i++)
+			loader_add_server(main, i * (MAX_SERVERS / server_counts[c]), 1);
+
+		// Route GET requests for documents that do not exist, so the work
+		// done by the server itself stays constant
+		double start = now_ns();
+		for (int i = 0; i < BENCH_REQUESTS; i++) {
+			request req = {
+				.type = GET_DOCUMENT,
+				.doc_name = names[i % BENCH_DOCS],
+			};
+
+			loader_forward_request(main, &req);
+		}
+		double elapsed = now_ns() - start;
+
+		printf("%10u %16.1f\n", server_counts[c], elapsed / BENCH_REQUESTS);
+
+		free_load_balancer(&main);
+	}
+
+	return 0;
+}
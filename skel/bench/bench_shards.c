@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Measures how the handling of the requests of an input file scales with
+// the number of shards (worker threads), compared to running the servers on
+// the main thread; the file is parsed beforehand, so only the routing, the
+// servers and the printing of the responses are timed
+
+#include <unistd.h>
+
+#include "../load_balancer.h"
+#include "../add/reader.h"
+#include "bench.h"
+
+#define BENCH_ROUNDS 5
+
+/*
+ * run() - Handles parsed requests the way main does, with a number of
+ * shards (0 to run the servers on the main thread).
+ *
+ * @return double - The best time of BENCH_ROUNDS runs, in ns.
+ */
+static double run(parsed_request *reqs, int requests_num, bool enable_vnodes,
+				  unsigned int shards_num)
+{
+	double best = 0;
+
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		double start = now_ns();
+
+		load_balancer *main = init_load_balancer(enable_vnodes);
+		loader_enable_shards(main, shards_num);
+
+		for (int i = 0; i < requests_num; i++) {
+			parsed_request *req = &reqs[i];
+
+			if (req->type == ADD_SERVER) {
+				loader_add_server(main, req->server_id, req->cache_size);
+			} else if (req->type == REMOVE_SERVER) {
+				loader_remove_server(main, req->server_id);
+			} else if (req->type == GET_DOCUMENT) {
+				request get = {
+					.type = req->type,
+					.doc_name = req->doc_name,
+				};
+
+				response *res = loader_forward_request(main, &get);
+				PRINT_RESPONSE(res);
+			} else {
+				request edit = {
+					.type = req->type,
+					.doc_name = strndup(req->doc_name, req->doc_name_length),
+					.doc_content = blob_create(req->doc_content,
+											   req->doc_content_length),
+				};
+
+				response *res = loader_forward_request(main, &edit);
+				PRINT_RESPONSE(res);
+
+				free(edit.doc_name);
+				blob_put(edit.doc_content);
+			}
+		}
+
+		free_load_balancer(&main);
+		writer_flush(writer_stdout());
+
+		double elapsed = now_ns() - start;
+		if (!round || elapsed < best)
+			best = elapsed;
+	}
+
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "../in/test30.in";
+	unsigned int max_shards = argc > 2 ? atoi(argv[2]) : 8;
+
+	// The requests are parsed once; their strings stay in the mapping
+	reader_t *r = reader_open(path);
+	DIE(!r, "reader_open");
+
+	int requests_num;
+	bool enable_vnodes;
+	reader_header(r, &requests_num, &enable_vnodes);
+
+	parsed_request *reqs = malloc(requests_num * sizeof(*reqs));
+	DIE(!reqs, "malloc requests");
+
+	for (int i = 0; i < requests_num; i++)
+		DIE(!reader_next(r, &reqs[i]), "insufficient requests");
+
+	// The responses are not part of the benchmark, only their printing
+	int out = mute_stdout();
+
+	dprintf(out, "%s: %d requests, %ld processors\n", path, requests_num,
+			sysconf(_SC_NPROCESSORS_ONLN));
+	dprintf(out, "%8s %10s %14s %10s\n", "shards", "ms", "requests/s",
+			"speedup");
+
+	double inline_ns = run(reqs, requests_num, enable_vnodes, 0);
+	dprintf(out, "%8s %10.1f %14.0f %10.2f\n", "none", inline_ns / 1e6,
+			requests_num / (inline_ns / 1e9), 1.0);
+
+	for (unsigned int shards = 1; shards <= max_shards; shards *= 2) {
+		double ns = run(reqs, requests_num, enable_vnodes, shards);
+
+		dprintf(out, "%8u %10.1f %14.0f %10.2f\n", shards, ns / 1e6,
+				requests_num / (ns / 1e9), inline_ns / ns);
+	}
+
+	free(reqs);
+	reader_close(&r);
+	close(out);
+
+	return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Runs tema2 end to end on synthetic workloads (made by gen_workload) and on
+// the input files of the tests, and reports one JSON object per workload:
+//
+//     ./bench_workloads [--rounds=N] [--no-generated] [--no-corpus]
+//                       [--keep] [-- <tema2 options>...]
+//
+// The best wall time of the rounds is reported, with the throughput, the
+// peak RSS and the allocations (counted by preloading alloc_count.so) of
+// that run. It is run from skel/, after "make build bench".
+
+#include <glob.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../utils.h"
+#include "bench.h"
+
+#define BENCH_ROUNDS 3
+#define BENCH_MAX_ARGS 16
+
+typedef struct workload {
+	const char *name;
+	const char *args[BENCH_MAX_ARGS];
+} workload;
+
+// The synthetic workloads, given as options of gen_workload
+static const workload workloads[] = {
+	{"uniform", {"--zipf=0", "--get-ratio=0.5"}},
+	{"zipf-read-heavy", {"--zipf=0.99", "--get-ratio=0.9"}},
+	{"zipf-write-heavy", {"--zipf=0.99", "--get-ratio=0.1"}},
+	{"big-documents", {"--requests=50000", "--content-min=1024",
+					   "--content-max=16384"}},
+	{"small-caches", {"--docs=100000", "--cache-min=1", "--cache-max=4"}},
+	{"vnodes-many-servers", {"--servers=200", "--vnodes"}},
+	{"churn", {"--servers=20", "--churn=0.01", "--vnodes"}},
+};
+
+// The result of running tema2 once
+typedef struct run_result {
+	double wall_ms;
+	long peak_rss_kb;
+	unsigned long allocs, frees, alloc_bytes;
+	int status;
+} run_result;
+
+/*
+ * spawn() - Runs a program with its standard output redirected to a file.
+ *
+ * @param usage: Gets the resources used by the program, if not NULL.
+ *
+ * @return int - The exit status of the program.
+ */
+static int spawn(char *const *argv, const char *out_path, char *const *env,
+				 struct rusage *usage)
+{
+	pid_t pid = fork();
+	DIE(pid < 0, "fork");
+
+	if (!pid) {
+		int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0)
+			_exit(127);
+		close(fd);
+
+		for (; env && *env; env++)
+			putenv(*env);
+
+		execv(argv[0], argv);
+		_exit(127);
+	}
+
+	int status;
+	struct rusage ignored;
+	DIE(wait4(pid, &status, 0, usage ? usage : &ignored) < 0, "wait4");
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/*
+ * generate() - Generates the input file of a synthetic workload.
+ */
+static void generate(const workload *w, const char *path)
+{
+	char *argv[BENCH_MAX_ARGS + 2] = {"./gen_workload"};
+	int argc = 1;
+
+	for (int i = 0; i < BENCH_MAX_ARGS && w->args[i]; i++)
+		argv[argc++] = (char *)w->args[i];
+	argv[argc] = NULL;
+
+	DIE(spawn(argv, path, NULL, NULL), "gen_workload");
+}
+
+/*
+ * run_once() - Runs tema2 on an input file, counting its allocations.
+ */
+static run_result run_once(const char *input, char **extra, int extra_num,
+						   const char *preload, const char *alloc_path)
+{
+	char *argv[extra_num + 3];
+	argv[0] = "./tema2";
+	argv[1] = (char *)input;
+	for (int i = 0; i < extra_num; i++)
+		argv[i + 2] = extra[i];
+	argv[extra_num + 2] = NULL;
+
+	char preload_env[PATH_MAX + 16], alloc_env[PATH_MAX + 32];
+	snprintf(preload_env, sizeof(preload_env), "LD_PRELOAD=%s", preload);
+	snprintf(alloc_env, sizeof(alloc_env), "ALLOC_COUNT_OUT=%s", alloc_path);
+	char *env[] = {preload_env, alloc_env, NULL};
+
+	run_result res = {0};
+	struct rusage usage;
+
+	double start = now_ns();
+	res.status = spawn(argv, "/dev/null", env, &usage);
+	res.wall_ms = (now_ns() - start) / 1e6;
+	res.peak_rss_kb = usage.ru_maxrss;
+
+	FILE *f = fopen(alloc_path, "r");
+	if (f) {
+		if (fscanf(f, "allocs=%lu frees=%lu bytes=%lu", &res.allocs,
+				   &res.frees, &res.alloc_bytes) != 3)
+			res.allocs = res.frees = res.alloc_bytes = 0;
+		fclose(f);
+	}
+
+	return res;
+}
+
+/*
+ * count_requests() - Reads the number of requests from the header of an
+ * input file.
+ */
+static long count_requests(const char *input)
+{
+	FILE *f = fopen(input, "r");
+	DIE(!f, "fopen input");
+
+	long requests = 0;
+	if (fscanf(f, "%ld", &requests) != 1)
+		requests = 0;
+	fclose(f);
+
+	return requests;
+}
+
+/*
+ * bench() - Runs tema2 on an input file and prints the JSON object of the
+ * best round.
+ */
+static void bench(const char *name, const char *source, const char *input,
+				  int rounds, char **extra, int extra_num, const char *preload,
+				  const char *alloc_path)
+{
+	run_result best = {0};
+
+	for (int round = 0; round < rounds; round++) {
+		run_result res = run_once(input, extra, extra_num, preload,
+								  alloc_path);
+
+		if (!round || res.wall_ms < best.wall_ms)
+			best = res;
+	}
+
+	long requests = count_requests(input);
+
+	printf("{\"workload\": \"%s\", \"source\": \"%s\", \"requests\": %ld, "
+		   "\"rounds\": %d, \"wall_ms\": %.2f, \"requests_per_s\": %.0f, "
+		   "\"peak_rss_kb\": %ld, \"allocs\": %lu, \"frees\": %lu, "
+		   "\"alloc_bytes\": %lu, \"exit_status\": %d}\n",
+		   name, source, requests, rounds, best.wall_ms,
+		   best.wall_ms ? requests / (best.wall_ms / 1e3) : 0.0,
+		   best.peak_rss_kb, best.allocs, best.frees, best.alloc_bytes,
+		   best.status);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = BENCH_ROUNDS;
+	bool generated = true, corpus = true, keep = false;
+	char **extra = NULL;
+	int extra_num = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strncmp(argv[i], "--rounds=", 9)) {
+			rounds = atoi(argv[i] + 9);
+		} else if (!strcmp(argv[i], "--no-generated")) {
+			generated = false;
+		} else if (!strcmp(argv[i], "--no-corpus")) {
+			corpus = false;
+		} else if (!strcmp(argv[i], "--keep")) {
+			keep = true;
+		} else if (!strcmp(argv[i], "--")) {
+			extra = argv + i + 1;
+			extra_num = argc - i - 1;
+			break;
+		} else {
+			DIE(1, "unknown option");
+		}
+	}
+	DIE(rounds <= 0, "the number of rounds must be positive");
+
+	// The library is preloaded into tema2, so it needs an absolute path
+	char preload[PATH_MAX];
+	DIE(!realpath("./alloc_count.so", preload), "alloc_count.so");
+	DIE(access("./tema2", X_OK), "tema2");
+
+	char dir[] = "/tmp/workloads_XXXXXX";
+	DIE(!mkdtemp(dir), "mkdtemp");
+
+	char alloc_path[PATH_MAX];
+	snprintf(alloc_path, sizeof(alloc_path), "%s/allocs", dir);
+
+	unsigned int workloads_num = sizeof(workloads) / sizeof(*workloads);
+	for (unsigned int i = 0; generated && i < workloads_num; i++) {
+		char input[PATH_MAX];
+		snprintf(input, sizeof(input), "%s/%s.in", dir, workloads[i].name);
+
+		generate(&workloads[i], input);
+		bench(workloads[i].name, "generated", input, rounds, extra,
+			  extra_num, preload, alloc_path);
+
+		if (!keep)
+			unlink(input);
+	}
+
+	glob_t files = {0};
+	if (corpus && !glob("../in/test*.in", 0, NULL, &files)) {
+		for (size_t i = 0; i < files.gl_pathc; i++) {
+			// Name the file without its directories and extension
+			char name[PATH_MAX];
+			snprintf(name, sizeof(name), "%s",
+					 strrchr(files.gl_pathv[i], '/') + 1);
+			*strrchr(name, '.') = '\0';
+
+			bench(name, "corpus", files.gl_pathv[i], rounds, extra,
+				  extra_num, preload, alloc_path);
+		}
+	}
+	globfree(&files);
+
+	unlink(alloc_path);
+	if (!keep)
+		rmdir(dir);
+	else
+		fprintf(stderr, "The workloads are kept in %s\n", dir);
+
+	return 0;
+}
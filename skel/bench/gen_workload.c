@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2024, <Ungureanu Vlad-Marin> <<2004uvm@gmail.com>>
+ */
+
+// Generates a synthetic input file for tema2, written to stdout:
+//
+//     ./gen_workload [--requests=N] [--get-ratio=F] [--docs=N] [--zipf=S]
+//                    [--content-min=N] [--content-max=N]
+//                    [--size-dist=fixed|uniform|loguniform]
+//                    [--servers=N] [--cache-min=N] [--cache-max=N]
+//                    [--churn=F] [--scan=F] [--stats=N] [--vnodes]
+//                    [--seed=N]
+//
+// The first requests add the initial servers; every following request is a
+// topology change with the probability given by --churn (an ADD_SERVER or a
+// REMOVE_SERVER, as long as at least one server is left), or else a GET
+// (with the probability given by --get-ratio) or an EDIT of a document
+// drawn from a Zipf distribution over --docs documents (0 for uniform);
+// with the probability given by --scan, the document is instead the next
+// one of a scan going through all of them, in the order of their IDs.
+// Every --stats-th request is a STATS request instead (0 for none).
+// The same options and seed always give the same file.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../constants.h"
+
+// Largest ID of a server (MAX_SERVERS in load_balancer.h)
+#define GEN_MAX_SERVER_ID 99999
+
+typedef enum size_dist {
+	SIZE_FIXED,
+	SIZE_UNIFORM,
+	SIZE_LOGUNIFORM
+} size_dist;
+
+typedef struct gen_options {
+	unsigned int requests;
+	double get_ratio;
+	unsigned int docs;
+	double zipf;
+	unsigned int content_min, content_max;
+	size_dist size_dist;
+	unsigned int servers;
+	unsigned int cache_min, cache_max;
+	double churn;
+	double scan;
+	unsigned int stats;
+	bool vnodes;
+	unsigned long seed;
+} gen_options;
+
+// State of the xorshift64* generator, so the files do not depend on libc
+static unsigned long long rng_state;
+
+static unsigned long long rng_next(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * rng_double() - Gets a number in [0, 1).
+ */
+static double rng_double(void)
+{
+	return (rng_next() >> 11) * (1.0 / (1ULL << 53));
+}
+
+/*
+ * rng_range() - Gets a number in [min, max].
+ */
+static unsigned int rng_range(unsigned int min, unsigned int max)
+{
+	return min + rng_next() % ((unsigned long long)max - min + 1);
+}
+
+/*
+ * zipf_cdf() - Computes the cumulative probabilities of the ranks of the
+ * documents, with the probability of rank k proportional to 1 / k^s.
+ */
+static double *zipf_cdf(unsigned int docs, double s)
+{
+	double *cdf = malloc(docs * sizeof(*cdf));
+	if (!cdf) {
+		perror("malloc cdf");
+		exit(EXIT_FAILURE);
+	}
+
+	double sum = 0;
+	for (unsigned int k = 0; k < docs; k++) {
+		sum += 1.0 / pow(k + 1, s);
+		cdf[k] = sum;
+	}
+
+	for (unsigned int k = 0; k < docs; k++)
+		cdf[k] /= sum;
+
+	return cdf;
+}
+
+/*
+ * pick_doc() - Draws a document: its rank is found by binary searching the
+ * cumulative probabilities, then mapped to an ID, so the popular documents
+ * are spread over all the names.
+ */
+static unsigned int pick_doc(const double *cdf, unsigned int docs)
+{
+	double u = rng_double();
+	unsigned int left = 0, right = docs - 1;
+
+	while (left < right) {
+		unsigned int mid = left + (right - left) / 2;
+
+		if (cdf[mid] < u)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+
+	// A multiplier coprime with the number of documents is a permutation
+	return (unsigned long long)left * 2654435761ULL % docs;
+}
+
+/*
+ * content_size() - Draws the size of the content of an EDIT.
+ */
+static unsigned int content_size(const gen_options *opt)
+{
+	switch (opt->size_dist) {
+	case SIZE_FIXED:
+		return opt->content_max;
+	case SIZE_UNIFORM:
+		return rng_range(opt->content_min, opt->content_max);
+	default:
+		// Uniform over the orders of magnitude: mostly small contents,
+		// with a few big ones
+		return exp(log(opt->content_min) + rng_double() *
+				   (log(opt->content_max) - log(opt->content_min)));
+	}
+}
+
+/*
+ * print_content() - Prints a content of words, size bytes long.
+ */
+static void print_content(unsigned int size)
+{
+	static const char *words[] = {
+		"alpha", "beta", "gamma", "delta", "server", "cache", "queue",
+		"ring", "hash", "document", "content", "replica", "lorem", "ipsum",
+	};
+	unsigned int words_num = sizeof(words) / sizeof(*words);
+	unsigned int printed = 0;
+
+	while (printed < size) {
+		const char *word = words[rng_next() % words_num];
+		unsigned int len = strlen(word);
+
+		if (printed && printed + 1 + len > size)
+			break;
+
+		printed += printf(printed ? " %s" : "%s", word);
+	}
+
+	// Pad the content to its size
+	for (; printed < size; printed++)
+		putchar('.');
+}
+
+/*
+ * add_server() - Adds a server with a new ID and prints its request.
+ */
+static void add_server(const gen_options *opt, bool *active,
+					   unsigned int *ids, unsigned int *active_num)
+{
+	unsigned int id;
+
+	do {
+		id = rng_range(0, GEN_MAX_SERVER_ID);
+	} while (active[id]);
+
+	active[id] = true;
+	ids[(*active_num)++] = id;
+
+	printf("%s %u %u\n", ADD_SERVER_REQUEST, id,
+		   rng_range(opt->cache_min, opt->cache_max));
+}
+
+/*
+ * remove_server() - Removes a random server and prints its request.
+ */
+static void remove_server(bool *active, unsigned int *ids,
+						  unsigned int *active_num)
+{
+	unsigned int idx = rng_next() % *active_num;
+	unsigned int id = ids[idx];
+
+	active[id] = false;
+	ids[idx] = ids[--*active_num];
+
+	printf("%s %u\n", REMOVE_SERVER_REQUEST, id);
+}
+
+/*
+ * parse_option() - Parses an option of the command line.
+ *
+ * @return bool - False if the option is unknown.
+ */
+static bool parse_option(gen_options *opt, const char *arg)
+{
+	const char *value = strchr(arg, '=');
+	value = value ? value + 1 : "";
+
+	if (!strncmp(arg, "--requests=", 11))
+		opt->requests = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--get-ratio=", 12))
+		opt->get_ratio = atof(value);
+	else if (!strncmp(arg, "--docs=", 7))
+		opt->docs = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--zipf=", 7))
+		opt->zipf = atof(value);
+	else if (!strncmp(arg, "--content-min=", 14))
+		opt->content_min = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--content-max=", 14))
+		opt->content_max = strtoul(value, NULL, 10);
+	else if (!strcmp(arg, "--size-dist=fixed"))
+		opt->size_dist = SIZE_FIXED;
+	else if (!strcmp(arg, "--size-dist=uniform"))
+		opt->size_dist = SIZE_UNIFORM;
+	else if (!strcmp(arg, "--size-dist=loguniform"))
+		opt->size_dist = SIZE_LOGUNIFORM;
+	else if (!strncmp(arg, "--servers=", 10))
+		opt->servers = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--cache-min=", 12))
+		opt->cache_min = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--cache-max=", 12))
+		opt->cache_max = strtoul(value, NULL, 10);
+	else if (!strncmp(arg, "--churn=", 8))
+		opt->churn = atof(value);
+	else if (!strncmp(arg, "--scan=", 7))
+		opt->scan = atof(value);
+	else if (!strncmp(arg, "--stats=", 8))
+		opt->stats = strtoul(value, NULL, 10);
+	else if (!strcmp(arg, "--vnodes"))
+		opt->vnodes = true;
+	else if (!strncmp(arg, "--seed=", 7))
+		opt->seed = strtoul(value, NULL, 10);
+	else
+		return false;
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	gen_options opt = {
+		.requests = 100000,
+		.get_ratio = 0.5,
+		.docs = 10000,
+		.zipf = 0.99,
+		.content_min = 8,
+		.content_max = 256,
+		.size_dist = SIZE_LOGUNIFORM,
+		.servers = 10,
+		.cache_min = 16,
+		.cache_max = 128,
+		.churn = 0.001,
+		.scan = 0,
+		.stats = 0,
+		.vnodes = false,
+		.seed = 1,
+	};
+
+	for (int i = 1; i < argc; i++) {
+		if (!parse_option(&opt, argv[i])) {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!opt.docs || !opt.servers || !opt.cache_min ||
+		opt.cache_min > opt.cache_max || !opt.content_min ||
+		opt.content_min > opt.content_max ||
+		opt.servers > opt.requests || opt.servers > GEN_MAX_SERVER_ID) {
+		fprintf(stderr, "Invalid options\n");
+		return EXIT_FAILURE;
+	}
+
+	// A zero state would only give zeros
+	rng_state = opt.seed * 0x9E3779B97F4A7C15ULL + 1;
+
+	double *cdf = zipf_cdf(opt.docs, opt.zipf);
+	bool *active = calloc(GEN_MAX_SERVER_ID + 1, sizeof(*active));
+	unsigned int *ids = malloc((GEN_MAX_SERVER_ID + 1) * sizeof(*ids));
+	if (!active || !ids) {
+		perror("malloc servers");
+		return EXIT_FAILURE;
+	}
+
+	printf("%u%s\n", opt.requests, opt.vnodes ? " ENABLE_VNODES" : "");
+
+	unsigned int active_num = 0, scanned = 0;
+	for (unsigned int i = 0; i < opt.servers; i++)
+		add_server(&opt, active, ids, &active_num);
+
+	for (unsigned int i = opt.servers; i < opt.requests; i++) {
+		if (opt.stats && (i + 1) % opt.stats == 0) {
+			printf("%s\n", STATS_REQUEST);
+			continue;
+		}
+
+		if (rng_double() < opt.churn) {
+			// Keep a server, and leave room for a new one
+			if (active_num > 1 &&
+				(active_num > GEN_MAX_SERVER_ID || rng_next() % 2))
+				remove_server(active, ids, &active_num);
+			else
+				add_server(&opt, active, ids, &active_num);
+			continue;
+		}
+
+		// Without scans, no number is drawn for them, so the files stay the
+		// same as before the option
+		unsigned int doc;
+		if (opt.scan && rng_double() < opt.scan)
+			doc = scanned++ % opt.docs;
+		else
+			doc = pick_doc(cdf, opt.docs);
+
+		if (rng_double() < opt.get_ratio) {
+			printf("%s \"doc_%u.txt\"\n", GET_REQUEST, doc);
+		} else {
+			printf("%s \"doc_%u.txt\" \"", EDIT_REQUEST, doc);
+			print_content(content_size(&opt));
+			printf("\"\n");
+		}
+	}
+
+	free(cdf);
+	free(active);
+	free(ids);
+
+	return 0;
+}
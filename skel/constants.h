@@ -15,6 +15,7 @@
 #define GET_REQUEST             "GET"
 #define ADD_SERVER_REQUEST      "ADD_SERVER"
 #define REMOVE_SERVER_REQUEST   "REMOVE_SERVER"
+#define STATS_REQUEST           "STATS"
 
 #define GENERIC_MSG     "[Server %d]-Response: %s\n[Server %d]-Log: %s\n\n"
 
@@ -25,6 +26,12 @@
 #define LOG_HIT     "Cache HIT for %s"
 #define LOG_MISS    "Cache MISS for %s"
 #define LOG_EVICT   "Cache MISS for %s - cache entry for %s has been evicted"
+#define LOG_EVICT_MANY \
+    "Cache MISS for %s - cache entries for %s have been evicted"
+#define LOG_HIT_EVICT \
+    "Cache HIT for %s - cache entry for %s has been evicted"
+#define LOG_HIT_EVICT_MANY \
+    "Cache HIT for %s - cache entries for %s have been evicted"
 
 #define LOG_FAULT       "Document %s doesn't exist"
 #define LOG_LAZY_EXEC   "Task queue size is %d"
@@ -35,7 +42,9 @@ typedef enum request_type {
     GET_DOCUMENT,
 
     ADD_SERVER,
-    REMOVE_SERVER
+    REMOVE_SERVER,
+
+    GET_STATS
 } request_type;
 
 #endif  /* CONSTANTS_H */
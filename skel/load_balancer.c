@@ -5,6 +5,32 @@
 #include "load_balancer.h"
 #include "server.h"
 
+/*
+ * ring_lower_bound() - Binary search a hash on the hash ring.
+ * 
+ * @main: The main load balancer.
+ * @hash: The hash to look for.
+ * 
+ * @return unsigned int - The index of the first label with a hash bigger than
+ * or equal to the given hash, or the size of the ring if there is none.
+ */
+static unsigned int ring_lower_bound(load_balancer *main, unsigned int hash)
+{
+	// Search in the [left, right) interval of the ring
+	unsigned int left = 0, right = main->ring_size;
+
+	while (left < right) {
+		unsigned int mid = left + (right - left) / 2;
+
+		if (main->ring[mid].hash < hash)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+
+	return left;
+}
+
 /*
  * get_server() - Get the server that should handle the request.
  * 
@@ -18,23 +44,292 @@
 */
 static unsigned int get_server(load_balancer *main, unsigned int hash)
 {
-	// Initialize slot to 0
-	unsigned int slot = 0;
+	unsigned int slot = ring_lower_bound(main, hash);
 
-	// Iterate through the servers
-	for (ll_node_t *curr = main->servers->head; curr; curr = curr->next) {
-		// Address the current server
-		server *curr_server = (server *)curr->data;
+	// If no server is found, return the first slot
+	return slot == main->ring_size ? 0 : slot;
+}
 
-		// Look for the server with the hash bigger than the given hash
-		if (hash <= main->hash_function_servers(&(curr_server->id)))
-			return slot;
+/*
+ * ring_insert() - Insert a label on the hash ring.
+ * 
+ * @main: The main load balancer.
+ * @slot: The position where the label should be placed.
+ * @hash: The hash of the label.
+ * @label: The ID of the label.
+ * @s: The server the label belongs to.
+ */
+static void ring_insert(load_balancer *main, unsigned int slot,
+						unsigned int hash, int label, server *s)
+{
+	// Grow the ring if there is no free slot left
+	if (main->ring_size == main->ring_capacity) {
+		main->ring_capacity *= 2;
+		main->ring = realloc(main->ring,
+							 main->ring_capacity * sizeof(*main->ring));
+		DIE(!main->ring, "realloc ring");
+	}
 
-		slot++;
+	// Shift the following labels to make room for the new one
+	memmove(main->ring + slot + 1, main->ring + slot,
+			(main->ring_size - slot) * sizeof(*main->ring));
+
+	main->ring[slot].hash = hash;
+	main->ring[slot].label = label;
+	main->ring[slot].s = s;
+	main->ring_size++;
+}
+
+/*
+ * ring_erase() - Remove a label from the hash ring.
+ * 
+ * @main: The main load balancer.
+ * @slot: The position of the label.
+ */
+static void ring_erase(load_balancer *main, unsigned int slot)
+{
+	// Shift the following labels over the removed one
+	memmove(main->ring + slot, main->ring + slot + 1,
+			(main->ring_size - slot - 1) * sizeof(*main->ring));
+
+	main->ring_size--;
+}
+
+/*
+ * move_document() - Move a document from a server to another.
+ * 
+ * @from: The server which currently stores the document.
+ * @to: The server which takes over the document.
+ * @key: The name of the document, as stored by the first server.
+ */
+static void move_document(server *from, server *to, void *key)
+{
+	// Remove the key from the first server's cache, while it still exists
+	lru_cache_remove(from->cache, key);
+
+	// Hand the content over to the second server, without copying it
+	oht_move_key(from->db, to->db, key);
+}
+
+/*
+ * move_documents() - Move the documents of an arc from a server to another.
+ * 
+ * @from: The server which currently stores the documents.
+ * @to: The server which takes over the documents.
+ * @arc_from: The hash where the arc starts (excluded).
+ * @arc_to: The hash where the arc ends (included).
+ * 
+ * @brief The databases hash their keys with the same function the ring
+ * routes the documents with, so the keys of the first server sorted by
+ * their hashes give the documents of the arc directly, in O(k log n) for
+ * k documents moved out of n.
+ */
+static void move_documents(server *from, server *to, unsigned int arc_from,
+						   unsigned int arc_to)
+{
+	// The keys after the start of the arc; the node after the current one
+	// is saved before the current one is removed
+	sl_node_t *node = sl_upper_bound(from->db->order, arc_from);
+	sl_node_t *next;
+
+	// An arc wrapping around the end of the ring also takes all the keys up
+	// to the end, then continues from the smallest hash
+	if (arc_from >= arc_to) {
+		for (; node; node = next) {
+			next = node->next[0];
+			move_document(from, to, node->key);
+		}
+
+		node = sl_first(from->db->order);
 	}
 
-	// If no server is found, return the first slot
-	return 0;
+	for (; node && node->hash <= arc_to; node = next) {
+		next = node->next[0];
+		move_document(from, to, node->key);
+	}
+}
+
+/*
+ * hand_cache_over() - Give the cached documents of a server which it no
+ * longer owns to the caches of their new servers.
+ * 
+ * @main: The main load balancer, whose ring already has its new topology.
+ * @from: The server whose documents are moved; it should have executed its
+ * tasks, so its cache is up to date.
+ * 
+ * @brief The entries are put from the least to the most recently used one
+ * (roughly, for the policies other than LRU), so when a cache is too small
+ * for all of them, the hottest are the ones kept.
+ * The contents are shared, not copied; the entries are removed from the first
+ * cache when their documents are moved.
+ */
+static void hand_cache_over(load_balancer *main, server *from)
+{
+	ll_node_t *node = lru_cache_next(from->cache, NULL);
+	for (; node; node = lru_cache_next(from->cache, node)) {
+		info_t *info = (info_t *)node->data;
+
+		// Get the server which now owns the document
+		unsigned int hash = main->hash_function_docs(info->key);
+		server *to = main->ring[get_server(main, hash)].s;
+
+		if (to == from)
+			continue;
+
+		lru_cache_put(to->cache, info->key, info->value, NULL);
+		main->handoff.entries++;
+	}
+}
+
+/*
+ * start_handoff_window() - Count a topology change and start measuring the
+ * hit rate of the GETs following it.
+ */
+static void start_handoff_window(load_balancer *main)
+{
+	main->handoff.topology_changes++;
+	main->handoff.window_left = HANDOFF_WINDOW;
+}
+
+/*
+ * get_shard() - Get the shard owning a server.
+ */
+static shard_t *get_shard(load_balancer *main, server *s)
+{
+	return main->shards[(unsigned int)s->id % main->shards_num];
+}
+
+/*
+ * queue_latency() - Get the latencies the task queue of a server is recorded
+ * into: the ones of its shard, if any, or the ones of the load balancer.
+ */
+static latency_t *queue_latency(load_balancer *main, server *s)
+{
+	if (!main->latency)
+		return NULL;
+
+	return main->shards_num ? get_shard(main, s)->latency : main->latency;
+}
+
+/*
+ * record_latency() - Count an operation and record the time since start as
+ * its latency, if it was timed (start is not 0).
+ */
+static void record_latency(load_balancer *main, latency_op op,
+						   unsigned long start)
+{
+	latency_record(main->latency, op, start);
+}
+
+/*
+ * execute_queue_in_order() - Execute the tasks of a server from the main
+ * thread, printing their responses after the ones already printed.
+ * 
+ * @brief The server's shard (if any) should be synced, so its responses
+ * are all printed and it does not touch the server.
+ */
+static void execute_queue_in_order(load_balancer *main, server *s)
+{
+	writer_t *out = s->out;
+	void (*print)(writer_t *, const response *) = s->print;
+
+	s->out = main->out;
+	s->print = main->print;
+	execute_queue(s);
+	s->out = out;
+	s->print = print;
+}
+
+/*
+ * get_owner_db() - Get the database of the server owning a hash.
+ * 
+ * @hash: The hash of a document.
+ * @ctx: The main load balancer.
+ * 
+ * @return open_hashtable_t* - The database the document belongs to.
+ */
+static open_hashtable_t *get_owner_db(unsigned int hash, void *ctx)
+{
+	load_balancer *main = ctx;
+	server *to = main->ring[get_server(main, hash)].s;
+
+	// Every call hands a document over to the server
+	to->stats.migrated_in++;
+
+	return to->db;
+}
+
+/*
+ * count_migration() - Count the documents moved from a server to another.
+ * 
+ * @main: The main load balancer.
+ * @from: The server which gave the documents.
+ * @to: The server which took the documents, or NULL if they were spread
+ * over several servers (which are counted by get_owner_db).
+ * @docs: The number of documents.
+ * @bytes: The size of their contents.
+ */
+static void count_migration(load_balancer *main, server *from, server *to,
+							unsigned long docs, unsigned long bytes)
+{
+	from->stats.migrated_out += docs;
+	if (to)
+		to->stats.migrated_in += docs;
+
+	main->stats.migrated_docs += docs;
+	main->stats.migrated_bytes += bytes;
+}
+
+/*
+ * add_server_stats() - Add the counters of a server to a total.
+ */
+static void add_server_stats(server_stats *total, const server_stats *stats)
+{
+	total->gets += stats->gets;
+	total->edits += stats->edits;
+	total->faults += stats->faults;
+	total->tasks += stats->tasks;
+	total->migrated_in += stats->migrated_in;
+	total->migrated_out += stats->migrated_out;
+
+	if (stats->peak_queue > total->peak_queue)
+		total->peak_queue = stats->peak_queue;
+}
+
+/*
+ * add_cache_stats() - Add the counters of a cache to a total.
+ */
+static void add_cache_stats(lru_stats *total, const lru_stats *stats)
+{
+	total->hits += stats->hits;
+	total->misses += stats->misses;
+	total->evictions += stats->evictions;
+}
+
+/*
+ * get_replicas() - Get the number of labels of a server on the hash ring.
+ * 
+ * @main: The main load balancer.
+ * 
+ * @return unsigned int - VNODES_REPLICAS if virtual nodes are enabled,
+ * 1 otherwise.
+ */
+static unsigned int get_replicas(load_balancer *main)
+{
+	return main->enable_vnodes ? VNODES_REPLICAS : 1;
+}
+
+/*
+ * get_label() - Get the ID of a replica of a server.
+ * 
+ * @server_id: The ID of the server.
+ * @replica: The index of the replica.
+ * 
+ * @return int - The ID of the label of the replica.
+ */
+static int get_label(int server_id, unsigned int replica)
+{
+	return replica * (MAX_SERVERS + 1) + server_id;
 }
 
 load_balancer *init_load_balancer(bool enable_vnodes)
@@ -47,177 +342,676 @@ load_balancer *init_load_balancer(bool enable_vnodes)
 	main->hash_function_servers = hash_uint;
 	main->hash_function_docs = hash_string;
 
-	// Initialize the servers list
-	main->servers = ll_create(sizeof(server));
-	DIE(!main->servers, "ll_create");
+	// Initialize the hash ring
+	main->ring_capacity = RING_INITIAL_CAPACITY;
+	main->ring = malloc(main->ring_capacity * sizeof(*main->ring));
+	DIE(!main->ring, "malloc ring");
 
 	// Set vnodes
 	main->enable_vnodes = enable_vnodes;
 
+	// Print the responses to the standard output
+	main->out = writer_stdout();
+	main->print = response_write;
+
 	// Return the main load balancer
 	return main;
 }
 
+void loader_enable_shards(load_balancer *main, unsigned int shards_num)
+{
+	// The servers cannot move to the shards once they exist
+	if (main->shards_num || main->ring_size || !shards_num)
+		return;
+
+	main->shards = malloc(shards_num * sizeof(*main->shards));
+	DIE(!main->shards, "malloc shards");
+
+	for (unsigned int i = 0; i < shards_num; i++) {
+		main->shards[i] = shard_start();
+
+		if (main->latency)
+			main->shards[i]->latency =
+				latency_create(main->latency->sample_every);
+	}
+
+	main->shards_num = shards_num;
+}
+
+void loader_enable_latency(load_balancer *main, unsigned int sample_every)
+{
+	if (main->latency)
+		return;
+
+	main->latency = latency_create(sample_every);
+
+	// The shards are idle until they get a request
+	for (unsigned int i = 0; i < main->shards_num; i++)
+		main->shards[i]->latency = latency_create(sample_every);
+
+	for (unsigned int i = 0; i < main->ring_size; i++)
+		main->ring[i].s->latency = queue_latency(main, main->ring[i].s);
+}
+
+void loader_set_output(load_balancer *main, writer_t *out,
+					   void (*print)(writer_t *w, const response *res))
+{
+	main->out = out;
+	main->print = print;
+
+	if (main->shards_num)
+		return;
+
+	// A server may have several labels, so it is set more than once
+	for (unsigned int i = 0; i < main->ring_size; i++) {
+		main->ring[i].s->out = out;
+		main->ring[i].s->print = print;
+	}
+}
+
+void loader_sync(load_balancer *main)
+{
+	if (!main->shards_num)
+		return;
+
+	for (unsigned int i = 0; i < main->shards_num; i++)
+		shard_wait(main->shards[i]);
+
+	// Print the responses in the order of their requests
+	shard_merge(main->shards, main->shards_num, main->out);
+
+	// Collect the GETs counted by the shards
+	for (unsigned int i = 0; i < main->shards_num; i++) {
+		shard_t *sh = main->shards[i];
+
+		main->handoff.gets += sh->gets;
+		main->handoff.hits += sh->hits;
+		main->handoff.window_gets += sh->window_gets;
+		main->handoff.window_hits += sh->window_hits;
+		sh->gets = sh->hits = sh->window_gets = sh->window_hits = 0;
+
+		if (main->latency)
+			latency_merge(main->latency, sh->latency);
+	}
+
+	main->synced = main->sequence;
+}
+
 void loader_add_server(load_balancer *main, int server_id, int cache_size)
 {
+	// The topology changes while no shard runs
+	loader_sync(main);
+	unsigned long start = main->latency ? hist_now() : 0;
+
 	// Initialize the server and set its id
 	server *s = init_server(cache_size);
 	s->id = server_id;
-
-	// If the server list is empty, add the server at the beginning
-	if (!ll_get_size(main->servers)) {
-		// Add the server to the list
-		ll_add_nth_node(main->servers, 0, s);
-
-		// Free the server and return
-		free(s);
-		return;
+	s->label = server_id;
+	s->latency = queue_latency(main, s);
+	main->stats.adds++;
+
+	if (main->write_combining)
+		server_enable_write_combining(s);
+
+	if (main->cache_policy)
+		server_set_cache_policy(s, main->cache_policy);
+
+	if (main->cache_bytes)
+		server_set_cache_budget(s, (unsigned long)cache_size *
+								   main->cache_bytes);
+
+	// The server prints the responses of its tasks in its shard's memory,
+	// or like the load balancer
+	if (main->shards_num) {
+		s->out = get_shard(main, s)->out;
+	} else {
+		s->out = main->out;
+		s->print = main->print;
 	}
 
-	// Get the hash of the server and the slot where it should be placed
-	unsigned int s_hash = main->hash_function_servers(&server_id);
-	unsigned int slot = get_server(main, s_hash);
-
-	// Check if the server should be placed at the end of the list or at the
-	// beginning; Only for servers placed between the last one and the first one
-	server *tail_server = (server *)main->servers->tail->data;
-	if (s_hash > main->hash_function_servers(&(tail_server->id)))
-		slot = ll_get_size(main->servers);
-
-	// Get the next server
-	unsigned int next_slot = slot % ll_get_size(main->servers);
-	server *next_s = ll_get_nth_node(main->servers, next_slot)->data;
-
-	// Execute the tasks in the queue of the next server
-	execute_queue(next_s);
-
-	// Iterate through the keys of the next server and move them to the current
-	// server
-	for (unsigned int b = 0; b < next_s->db->hmax; b++) {
-		ll_node_t *curr = next_s->db->buckets[b]->head;
-
-		while (curr) {
-			// Get the hash of the key
-			unsigned int hash =
-				main->hash_function_docs(((info_t *)curr->data)->key);
-
-			// Check if the key should be moved to the current server
-			// Special case: if the next server is the first one and the key is
-			// before 0 on the ring
-			if (hash < s_hash ||
-				(next_s == main->servers->head->data &&
-				 hash >= main->hash_function_servers(&next_s->id))) {
-				// Add the key to the current server
-				ht_put(s->db, ((info_t *)curr->data)->key,
-					   strlen(((info_t *)curr->data)->key) + 1,
-					   ((info_t *)curr->data)->value,
-					   strlen(((info_t *)curr->data)->value) + 1);
-
-				// Remove the key from the next server's cache and database
-				lru_cache_remove(next_s->cache, ((info_t *)curr->data)->key);
-				ht_remove_entry(next_s->db, ((info_t *)curr->data)->key);
-
-				// Start from the beginning of the list again
-				curr = next_s->db->buckets[b--]->head;
-				break;
-			}
-
-			// Move to the next key
-			curr = curr->next;
+	// Place every label of the server on the ring, one at a time
+	for (unsigned int r = 0; r < get_replicas(main); r++) {
+		// Get the hash of the label and the slot where it should be placed
+		int label = get_label(server_id, r);
+		unsigned int l_hash = main->hash_function_servers(&label);
+		unsigned int slot = ring_lower_bound(main, l_hash);
+
+		// If the ring is empty, there are no documents to take over
+		if (!main->ring_size) {
+			ring_insert(main, slot, l_hash, label, s);
+			continue;
 		}
+
+		if (r == 0)
+			start_handoff_window(main);
+
+		// Get the next server and the hash of the previous label; the label
+		// takes over the (prev_hash, l_hash] arc of the ring
+		server *next_s = main->ring[slot % main->ring_size].s;
+		unsigned int prev_hash =
+			main->ring[(slot + main->ring_size - 1) % main->ring_size].hash;
+
+		// Add the label to the ring
+		ring_insert(main, slot, l_hash, label, s);
+
+		// The arc already belongs to the new server through another replica
+		if (next_s == s)
+			continue;
+
+		// Execute the tasks in the queue of the next server
+		execute_queue_in_order(main, next_s);
+
+		// Warm the cache of the new server with the cached keys of the arc
+		if (main->warm_handoff)
+			hand_cache_over(main, next_s);
+
+		// Move the keys of the arc to the new server, counting them by how
+		// much its database grows
+		unsigned int docs = oht_get_size(s->db);
+		unsigned long bytes = oht_get_bytes(s->db);
+
+		move_documents(next_s, s, prev_hash, l_hash);
+		count_migration(main, next_s, s, oht_get_size(s->db) - docs,
+						oht_get_bytes(s->db) - bytes);
 	}
 
-	// Add the server to the list and free the server
-	ll_add_nth_node(main->servers, slot, s);
-	free(s);
+	record_latency(main, LATENCY_ADD_SERVER, start);
 }
 
 void loader_remove_server(load_balancer *main, int server_id)
 {
-	// Get the hash of the server and the slot where it should be placed
-	unsigned int s_hash = main->hash_function_servers(&server_id);
-	unsigned int slot = get_server(main, s_hash);
-	server *s = ll_get_nth_node(main->servers, slot)->data;
+	server *s = NULL;
 
-	// If there is only one server, remove it and return
-	if (ll_get_size(main->servers) == 1) {
-		// Free the server and the node from the list of servers
-		free_server(&s);
-		free(ll_remove_nth_node(main->servers, slot));
+	// The topology changes while no shard runs
+	loader_sync(main);
+	unsigned long start = main->latency ? hist_now() : 0;
 
-		return;
+	// Remove every label of the server from the ring
+	for (unsigned int r = 0; r < get_replicas(main); r++) {
+		// Get the hash of the label and the slot where it is placed
+		int label = get_label(server_id, r);
+		unsigned int l_hash = main->hash_function_servers(&label);
+		unsigned int slot = ring_lower_bound(main, l_hash);
+
+		// Check if the label is on the ring
+		if (slot == main->ring_size || main->ring[slot].hash != l_hash)
+			continue;
+
+		s = main->ring[slot].s;
+		ring_erase(main, slot);
 	}
 
-	// Get the next server
-	unsigned int next_slot = (slot + 1) % ll_get_size(main->servers);
-	server *next_s = ll_get_nth_node(main->servers, next_slot)->data;
+	// Check if the server was on the ring
+	if (!s)
+		return;
 
-	// Execute the tasks in the queue of the current server
-	execute_queue(s);
+	// Execute the tasks in the queue of the server on its own behalf
+	s->label = s->id;
+	execute_queue_in_order(main, s);
 
-	// Iterate through the keys of the current server and move them to the next
-	// server
-	for (unsigned int b = 0; b < s->db->hmax; b++) {
-		for (ll_node_t *curr = s->db->buckets[b]->head; curr;
-			 curr = curr->next) {
-			ht_put(next_s->db, ((info_t *)curr->data)->key,
-				   strlen(((info_t *)curr->data)->key) + 1,
-				   ((info_t *)curr->data)->value,
-				   strlen(((info_t *)curr->data)->value) + 1);
-		}
+	// Give every document of the server to its new owner, if there is one;
+	// the entries are handed over as they are, so nothing is copied
+	if (main->ring_size) {
+		start_handoff_window(main);
+
+		// Warm the caches of the new owners with the cached documents
+		if (main->warm_handoff)
+			hand_cache_over(main, s);
+
+		count_migration(main, s, NULL, oht_get_size(s->db),
+						oht_get_bytes(s->db));
+		oht_move_all(s->db, get_owner_db, main);
 	}
 
-	// Free the server and the node from the list of servers
+	// Keep the counters of the server in the totals of the cluster
+	main->stats.removes++;
+	add_server_stats(&main->stats.removed, &s->stats);
+	add_cache_stats(&main->stats.removed_cache, &s->cache->stats);
+
+	// Free the server
 	free_server(&s);
-	free(ll_remove_nth_node(main->servers, slot));
+
+	record_latency(main, LATENCY_REMOVE_SERVER, start);
+}
+
+void loader_print_distribution(load_balancer *main, FILE *out)
+{
+	unsigned int servers = 0, total = 0;
+	unsigned int min_docs = 0, max_docs = 0;
+
+	// Every server is reported once, through its first label
+	for (unsigned int i = 0; i < main->ring_size; i++) {
+		if (main->ring[i].label > MAX_SERVERS)
+			continue;
+
+		server *s = main->ring[i].s;
+		unsigned int docs = oht_get_size(s->db);
+		fprintf(out, "Server %d: %u documents\n", s->id, docs);
+
+		// Update the totals
+		if (!servers || docs < min_docs)
+			min_docs = docs;
+		if (docs > max_docs)
+			max_docs = docs;
+		total += docs;
+		servers++;
+	}
+
+	if (!servers)
+		return;
+
+	fprintf(out, "Servers: %u, documents: %u, min: %u, max: %u, avg: %.2f\n",
+			servers, total, min_docs, max_docs, (double)total / servers);
+}
+
+void loader_print_memory(load_balancer *main, FILE *out)
+{
+	// Every server is reported once, through its first label
+	for (unsigned int i = 0; i < main->ring_size; i++) {
+		if (main->ring[i].label > MAX_SERVERS)
+			continue;
+
+		fprintf(out, "Server %d:\n", main->ring[i].s->id);
+		arena_print_stats(main->ring[i].s->arena, out);
+	}
+}
+
+void loader_print_handoff(load_balancer *main, FILE *out)
+{
+	handoff_stats *stats = &main->handoff;
+
+	fprintf(out, "Topology changes: %u, cache entries handed over: %u\n",
+			stats->topology_changes, stats->entries);
+
+	fprintf(out, "Hit rate: %.2f%% (%lu / %lu GETs)\n",
+			stats->gets ? 100.0 * stats->hits / stats->gets : 0.0,
+			stats->hits, stats->gets);
+
+	fprintf(out, "Hit rate in the first %d GETs after a change: "
+			"%.2f%% (%lu / %lu GETs)\n", HANDOFF_WINDOW,
+			stats->window_gets ?
+			100.0 * stats->window_hits / stats->window_gets : 0.0,
+			stats->window_hits, stats->window_gets);
+}
+
+void loader_print_latency(load_balancer *main, FILE *out)
+{
+	if (main->latency)
+		latency_print(main->latency, out);
+}
+
+void loader_print_stats(load_balancer *main, FILE *out)
+{
+	// The totals start from the counters of the removed servers
+	server_stats total = main->stats.removed;
+	lru_stats total_cache = main->stats.removed_cache;
+	unsigned int servers = 0, queued = 0, cached = 0, docs = 0;
+	unsigned long bytes = 0;
+
+	// Every server is reported once, through its first label
+	for (unsigned int i = 0; i < main->ring_size; i++) {
+		if (main->ring[i].label > MAX_SERVERS)
+			continue;
+
+		server *s = main->ring[i].s;
+		server_stats *stats = &s->stats;
+		lru_stats *cache = &s->cache->stats;
+
+		fprintf(out, "Server %d: gets=%lu hits=%lu misses=%lu faults=%lu "
+				"edits=%lu tasks=%lu queue=%u peak_queue=%u evictions=%lu "
+				"cached=%u/%u documents=%u bytes=%lu migrated_in=%lu "
+				"migrated_out=%lu", s->id, stats->gets, cache->hits,
+				cache->misses, stats->faults, stats->edits, stats->tasks,
+				q_get_size(s->tasks), stats->peak_queue, cache->evictions,
+				s->cache->size, s->cache->capacity,
+				oht_get_size(s->db), oht_get_bytes(s->db),
+				stats->migrated_in, stats->migrated_out);
+
+		// The bytes of the cache, when they bound it
+		if (s->cache->byte_capacity)
+			fprintf(out, " cached_bytes=%lu/%lu", s->cache->bytes,
+					s->cache->byte_capacity);
+		fprintf(out, "\n");
+
+		// Update the totals
+		add_server_stats(&total, stats);
+		add_cache_stats(&total_cache, cache);
+		queued += q_get_size(s->tasks);
+		cached += s->cache->size;
+		docs += oht_get_size(s->db);
+		bytes += oht_get_bytes(s->db);
+		servers++;
+	}
+
+	fprintf(out, "Cluster: servers=%u added=%lu removed=%lu gets=%lu "
+			"hits=%lu misses=%lu faults=%lu edits=%lu tasks=%lu queue=%u "
+			"peak_queue=%u evictions=%lu cached=%u documents=%u bytes=%lu "
+			"migrated=%lu migrated_bytes=%lu stats_requests=%lu\n", servers,
+			main->stats.adds, main->stats.removes, total.gets,
+			total_cache.hits, total_cache.misses, total.faults, total.edits,
+			total.tasks, queued, total.peak_queue, total_cache.evictions,
+			cached, docs, bytes, main->stats.migrated_docs,
+			main->stats.migrated_bytes, main->stats.stats_requests);
+}
+
+void loader_handle_stats(load_balancer *main)
+{
+	// The servers of the shards are only read once the shards are idle
+	loader_sync(main);
+	main->stats.stats_requests++;
+
+	// Format the report in memory, so it can be printed like a response
+	char *text;
+	size_t length;
+	FILE *report = open_memstream(&text, &length);
+	DIE(!report, "open_memstream");
+
+	loader_print_stats(main, report);
+	fclose(report);
+
+	response res = {
+		.msg = RESPONSE_STATS,
+		.doc_content = blob_create(text, length),
+	};
+	main->print(main->out, &res);
+
+	blob_put((void *)res.doc_content);
+	free(text);
 }
 
 // Helper function to print the servers; used for debugging
 void print_servers(load_balancer *main)
 {
-	for (ll_node_t *curr = main->servers->head; curr; curr = curr->next) {
-		server *s = curr->data;
-
-		printf("Server %5d\t\t\t\t\t\t - %x\n", s->id,
-			   main->hash_function_servers(&s->id));
-
-		for (unsigned int b = 0; b < s->db->hmax; b++) {
-			for (ll_node_t *curr = s->db->buckets[b]->head; curr;
-				 curr = curr->next) {
-				printf("\t%32s - %x ; from bucket %x\n",
-					   (char *)((info_t *)curr->data)->key,
-					   main->hash_function_docs(((info_t *)curr->data)->key),
-					   main->hash_function_docs(((info_t *)curr->data)->key) %
-						   s->db->hmax);
-			}
+	for (unsigned int i = 0; i < main->ring_size; i++) {
+		server *s = main->ring[i].s;
+
+		printf("Server %5d\t\t\t\t\t\t - %x\n", main->ring[i].label,
+			   main->ring[i].hash);
+
+		oht_entry_t *entry;
+		for (unsigned int pos = 0; (entry = oht_next(s->db, &pos));) {
+			printf("\t%32s - %x ; from slot %x\n", (char *)entry->key,
+				   main->hash_function_docs(entry->key), pos - 1);
 		}
 	}
 }
 
+/*
+ * count_get() - Count a GET, as a hit if it was answered from the cache.
+ * 
+ * @main: The main load balancer.
+ * @res: The response to the GET.
+ * @in_window: Whether the GET is in the window after a topology change.
+ */
+static void count_get(load_balancer *main, response *res, bool in_window)
+{
+	bool hit = res && res->log == RESPONSE_LOG_HIT;
+
+	main->handoff.gets++;
+	main->handoff.hits += hit;
+
+	if (in_window) {
+		main->handoff.window_gets++;
+		main->handoff.window_hits += hit;
+	}
+}
+
+/*
+ * forward_to_shard() - Send a request to the shard of its server.
+ * 
+ * @main: The main load balancer.
+ * @req: The request, whose strings are taken if it is an EDIT.
+ * @s: The server that should handle the request.
+ * @label: The label the server was found on.
+ * 
+ * @return response* - NULL, since the response is printed by loader_sync.
+ */
+static response *forward_to_shard(load_balancer *main, request *req,
+								  server *s, int label)
+{
+	shard_task task = {
+		.seq = main->sequence++,
+		.s = s,
+		.label = label,
+		.req = *req,
+	};
+
+	// The GETs are counted by the shards, in the windows decided here
+	if (req->type == GET_DOCUMENT && main->handoff.window_left) {
+		main->handoff.window_left--;
+		task.in_window = true;
+	}
+
+	// The task owns the strings of an EDIT from now on
+	if (req->type == EDIT_DOCUMENT) {
+		req->doc_name = NULL;
+		req->doc_content = NULL;
+	}
+
+	shard_dispatch(get_shard(main, s), &task);
+
+	// Bound the responses kept by the shards
+	if (main->sequence - main->synced >= SHARD_EPOCH_REQUESTS)
+		loader_sync(main);
+
+	return NULL;
+}
+
 response *loader_forward_request(load_balancer *main, request *req)
 {
 	// print_servers(main);
 
-	// Get the hash of the document and the slot where it should be placed
-	unsigned int hash = main->hash_function_docs(req->doc_name);
+	// There is no server to handle the request
+	if (!main->ring_size)
+		return NULL;
+
+	// Get the hash of the document, then forward the request by it
+	return loader_forward_hashed(main, req,
+								 main->hash_function_docs(req->doc_name));
+}
+
+response *loader_forward_hashed(load_balancer *main, request *req,
+								unsigned int hash)
+{
+	// There is no server to handle the request
+	if (!main->ring_size)
+		return NULL;
+
+	// Time the request from its routing; the shards time their own
+	unsigned long start = 0;
+	if (!main->shards_num)
+		start = latency_start(main->latency);
+
+	// Get the slot where the document should be placed
 	unsigned int slot = get_server(main, hash);
 
-	// Get the server that should handle the request
-	server *s = ll_get_nth_node(main->servers, slot)->data;
+	// Forward the request to the server that should handle it, through the
+	// label it was found on
+	server *s = main->ring[slot].s;
+
+	if (main->shards_num)
+		return forward_to_shard(main, req, s, main->ring[slot].label);
+
+	s->label = main->ring[slot].label;
+
+	// Count the GET, which is in the window if there are GETs left in it
+	bool in_window = false;
+	if (req->type == GET_DOCUMENT && main->handoff.window_left) {
+		main->handoff.window_left--;
+		in_window = true;
+	}
+
+	response *res = server_handle_request(s, req);
+	if (req->type == GET_DOCUMENT)
+		count_get(main, res, in_window);
+
+	record_latency(main, latency_outcome(req->type, res), start);
 
-	// Forward the request to the server
-	return server_handle_request(s, req);
+	return res;
 }
 
-void free_load_balancer(load_balancer **main)
+/*
+ * compare_entries() - Order the requests of a batch by their servers, then
+ * by their order in the batch.
+ */
+static int compare_entries(const void *a, const void *b)
+{
+	const batch_entry *x = a, *y = b;
+
+	if (x->s->id != y->s->id)
+		return x->s->id < y->s->id ? -1 : 1;
+
+	return x->idx < y->idx ? -1 : x->idx > y->idx;
+}
+
+/*
+ * reserve_batch() - Grow the scratch space of the batches to fit n requests.
+ */
+static void reserve_batch(load_balancer *main, unsigned int n)
+{
+	if (!main->batch_out)
+		main->batch_out = writer_memory();
+
+	if (n <= main->batch_capacity)
+		return;
+
+	main->batch = realloc(main->batch, n * sizeof(*main->batch));
+	DIE(!main->batch, "realloc batch");
+
+	main->batch_chunks = realloc(main->batch_chunks,
+								 n * sizeof(*main->batch_chunks));
+	DIE(!main->batch_chunks, "realloc batch chunks");
+
+	main->batch_capacity = n;
+}
+
+/*
+ * handle_slice() - Let a server handle its requests of a batch, keeping
+ * their responses in the batch's writer.
+ * 
+ * @main: The main load balancer.
+ * @reqs: The requests of the batch.
+ * @slice: The entries of the server's requests, in their order.
+ * @n: The number of entries.
+ */
+static void handle_slice(load_balancer *main, request *reqs,
+						 batch_entry *slice, unsigned int n)
 {
-	// Free the servers from the list of servers
-	for (ll_node_t *curr = (*main)->servers->head; curr; curr = curr->next) {
-		free_server((server **)&curr->data);
+	server *s = slice[0].s;
+	writer_t *w = main->batch_out;
+
+	// The responses of the executed tasks are kept with the others
+	writer_t *out = s->out;
+	void (*print)(writer_t *, const response *) = s->print;
+	s->out = w;
+	s->print = main->print;
+
+	for (unsigned int i = 0; i < n; i++) {
+		request *req = &reqs[slice[i].idx];
+		batch_chunk *chunk = &main->batch_chunks[slice[i].idx];
+
+		// The responses start after the bytes written so far
+		chunk->start = w->memory_length + w->length;
+
+		s->label = slice[i].label;
+		unsigned long start = latency_start(main->latency);
+		response *res = server_handle_request(s, req);
+		record_latency(main, latency_outcome(req->type, res), start);
+
+		if (res)
+			main->print(w, res);
+
+		if (req->type == GET_DOCUMENT)
+			count_get(main, res, slice[i].in_window);
+
+		chunk->end = w->memory_length + w->length;
+	}
+
+	s->out = out;
+	s->print = print;
+}
+
+void loader_forward_batch(load_balancer *main, request *reqs,
+						  const unsigned int *hashes, unsigned int n)
+{
+	// There is no server to handle the requests
+	if (!n || !main->ring_size)
+		return;
+
+	// The shards already group the requests by their servers
+	if (main->shards_num) {
+		for (unsigned int i = 0; i < n; i++)
+			loader_forward_hashed(main, &reqs[i], hashes ? hashes[i] :
+								  main->hash_function_docs(reqs[i].doc_name));
+		return;
+	}
+
+	reserve_batch(main, n);
+
+	// Route all the requests first; the windows follow their order
+	for (unsigned int i = 0; i < n; i++) {
+		unsigned int hash = hashes ? hashes[i] :
+							main->hash_function_docs(reqs[i].doc_name);
+		unsigned int slot = get_server(main, hash);
+
+		batch_entry *entry = &main->batch[i];
+		entry->s = main->ring[slot].s;
+		entry->label = main->ring[slot].label;
+		entry->idx = i;
+		entry->in_window = false;
+
+		if (reqs[i].type == GET_DOCUMENT && main->handoff.window_left) {
+			main->handoff.window_left--;
+			entry->in_window = true;
+		}
 	}
 
-	// Free the list of servers
-	ll_free(&(*main)->servers);
+	// Group the requests by their servers, keeping their order
+	qsort(main->batch, n, sizeof(*main->batch), compare_entries);
+
+	for (unsigned int i = 0, j; i < n; i = j) {
+		for (j = i + 1; j < n && main->batch[j].s == main->batch[i].s; j++)
+			;
+
+		handle_slice(main, reqs, main->batch + i, j - i);
+	}
+
+	// Print the responses in the order of the requests
+	writer_t *w = main->batch_out;
+	writer_flush(w);
+
+	for (unsigned int i = 0; i < n; i++) {
+		batch_chunk *chunk = &main->batch_chunks[i];
+		writer_write(main->out, w->memory + chunk->start,
+					 chunk->end - chunk->start);
+	}
+
+	w->memory_length = 0;
+}
+
+void free_load_balancer(load_balancer **main)
+{
+	// Print the last responses, then stop the shards
+	loader_sync(*main);
+	for (unsigned int i = 0; i < (*main)->shards_num; i++)
+		shard_stop(&(*main)->shards[i]);
+	free((*main)->shards);
+
+	// Free the servers from the hash ring, once for each server (through
+	// the label of their first replica)
+	for (unsigned int i = 0; i < (*main)->ring_size; i++)
+		if ((*main)->ring[i].label <= MAX_SERVERS)
+			free_server(&(*main)->ring[i].s);
+
+	// Free the hash ring
+	free((*main)->ring);
+
+	// Free the scratch space of the batches
+	free((*main)->batch);
+	free((*main)->batch_chunks);
+	writer_close(&(*main)->batch_out);
+
+	latency_free(&(*main)->latency);
 
 	// Free the main load balancer
 	free(*main);
@@ -6,19 +6,146 @@
 #define LOAD_BALANCER_H
 
 #include "server.h"
+#include "add/latency.h"
+#include "add/shard.h"
 
 #define MAX_SERVERS 99999
+#define RING_INITIAL_CAPACITY 8
+
+// Number of labels of a server on the hash ring when virtual nodes are enabled
+#define VNODES_REPLICAS 3
+
+// Number of GETs after a topology change whose hit rate is reported apart
+#define HANDOFF_WINDOW 100
+
+// Number of requests after which the shards are synced, so the responses
+// they keep in memory stay bounded
+#define SHARD_EPOCH_REQUESTS 4096
+
+typedef struct ring_node {
+	// Position of the label on the hash ring
+	unsigned int hash;
+
+	// ID of the label: replica_id * (MAX_SERVERS + 1) + server_id
+	int label;
+
+	// Server the label belongs to
+	server *s;
+} ring_node;
+
+// A request of a batch, routed to its server
+typedef struct batch_entry {
+	// Server handling the request and the label it was found on
+	server *s;
+	int label;
+
+	// Index of the request in the batch
+	unsigned int idx;
+
+	// Whether the request is a GET in the window after a topology change
+	bool in_window;
+} batch_entry;
+
+// Where the responses of a request of a batch start and end, in the memory
+// of the batch's writer
+typedef struct batch_chunk {
+	size_t start;
+	size_t end;
+} batch_chunk;
+
+typedef struct handoff_stats {
+	// Number of servers added to or removed from a non-empty ring
+	unsigned int topology_changes;
+
+	// Number of cache entries handed over to the new owners of their documents
+	unsigned int entries;
+
+	// Number of GETs and of cache hits, overall and in the windows of
+	// HANDOFF_WINDOW GETs following the topology changes
+	unsigned long gets, hits;
+	unsigned long window_gets, window_hits;
+
+	// Number of GETs left in the current window
+	unsigned int window_left;
+} handoff_stats;
+
+// Counters of the load balancer, with the ones of the removed servers, so
+// the totals of the cluster do not drop when a server leaves
+typedef struct cluster_stats {
+	// Servers added and removed, and STATS requests
+	unsigned long adds, removes;
+	unsigned long stats_requests;
+
+	// Documents, and the bytes of their contents, moved between servers
+	// when the topology changed
+	unsigned long migrated_docs, migrated_bytes;
+
+	// Counters of the servers which were removed, and of their caches
+	server_stats removed;
+	lru_stats removed_cache;
+} cluster_stats;
 
 typedef struct load_balancer {
 	// Hash functions for servers and documents
 	unsigned int (*hash_function_servers)(void *);
 	unsigned int (*hash_function_docs)(void *);
 
-	// List of servers
-	ll_list_t *servers;
+	// Hash ring, kept sorted by the hash of the labels
+	ring_node *ring;
+
+	// Number of labels on the ring and the number of allocated slots
+	unsigned int ring_size;
+	unsigned int ring_capacity;
 
 	// Flag for virtual nodes
 	bool enable_vnodes;
+
+	// Flag for combining the queued edits of the servers
+	bool write_combining;
+
+	// Flag for handing the cached documents over when the topology changes;
+	// the responses keep their contents, but their cache logs change
+	bool warm_handoff;
+
+	// Replacement policy of the servers' caches; NULL for LRU
+	const cache_policy *cache_policy;
+
+	// Bytes of names and contents every unit of the cache size of a server
+	// is worth; 0 to bound the caches by their number of documents
+	unsigned long cache_bytes;
+
+	// Cache entries handed over and hit rates around the topology changes
+	handoff_stats handoff;
+
+	// Counters of the topology changes and of the removed servers
+	cluster_stats stats;
+
+	// Latencies of the requests, the task queues and the topology changes;
+	// NULL unless they are recorded
+	latency_t *latency;
+
+	// Writer the responses printed by the load balancer and its servers go
+	// to, and the way they are printed: response_write to the standard
+	// output, unless the requests run in a pipeline
+	writer_t *out;
+	void (*print)(writer_t *w, const response *res);
+
+	// Scratch space of loader_forward_batch, grown to the largest batch,
+	// and the writer keeping the responses until they are put in order
+	batch_entry *batch;
+	batch_chunk *batch_chunks;
+	unsigned int batch_capacity;
+	writer_t *batch_out;
+
+	// Shards running the servers on worker threads, by server ID modulo
+	// their number; none when the servers run on the main thread
+	shard_t **shards;
+	unsigned int shards_num;
+
+	// Sequence number of the next request sent to a shard and of the first
+	// one sent since the last sync
+	unsigned long sequence;
+	unsigned long synced;
 } load_balancer;
 
 /**
@@ -29,7 +156,7 @@ typedef struct load_balancer {
  * @return load_balancer* - The initialized load balancer.
  * 
  * @brief The load balancer will have the hash functions set to hash_uint
- * and hash_string, the servers list initialized and the enable_vnodes flag
+ * and hash_string, the hash ring initialized and the enable_vnodes flag
  * set to the given value.
  */
 load_balancer *init_load_balancer(bool enable_vnodes);
@@ -43,17 +170,77 @@ load_balancer *init_load_balancer(bool enable_vnodes);
  */
 void free_load_balancer(load_balancer **main);
 
+/**
+ * loader_enable_shards() - Runs the servers on worker threads.
+ * 
+ * @param main: Load balancer which distributes the work, without servers.
+ * @param shards_num: Number of worker threads (shards).
+ * 
+ * @brief Every server is owned by a shard, which handles all of its
+ * requests, in their order, and keeps their responses in memory, tagged
+ * with their sequence numbers. The responses are printed by loader_sync,
+ * merged back in the order of the requests, so the output is the same as
+ * on a single thread. Topology changes are barriers: the shards are synced
+ * first, then the servers are changed by the main thread.
+ */
+void loader_enable_shards(load_balancer *main, unsigned int shards_num);
+
+/**
+ * loader_enable_latency() - Records the latency of the forwarded requests
+ * (by their outcome), of the executions of non-empty task queues and of
+ * every topology change.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param sample_every: One in this many requests and task queue executions
+ * (a power of two) is timed, picked at random; all of them are counted.
+ * 
+ * @brief A timed operation costs two reads of the monotonic clock and the
+ * increment of a bucket, the other ones the increment of their count. With
+ * shards, every shard records the requests and task queues of its servers
+ * in histograms of its own, which are added to the ones of the load
+ * balancer by loader_sync.
+ */
+void loader_enable_latency(load_balancer *main, unsigned int sample_every);
+
+/**
+ * loader_set_output() - Changes where the load balancer and its servers
+ * print their responses, and the way they do it.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param out: Writer the responses go to.
+ * @param print: Function printing a response to the writer (e.g.
+ * response_write, or response_pack for the pipeline).
+ * 
+ * @brief The servers added later take them too. With shards, the servers
+ * keep printing to the writers of their shards.
+ */
+void loader_set_output(load_balancer *main, writer_t *out,
+					   void (*print)(writer_t *w, const response *res));
+
+/**
+ * loader_sync() - Waits for the shards to handle all the requests sent to
+ * them, then prints their responses in order; nothing to do without shards.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * 
+ * @brief It should be called after the last request, before the servers
+ * are inspected (e.g. by loader_print_distribution).
+ */
+void loader_sync(load_balancer *main);
+
 /**
  * loader_add_server() - Adds a new server to the system.
  * 
  * @param main: Load balancer which distributes the work.
  * @param server_id: ID of the new server.
- * @param cache_size: Capacity of the new server's cache.
+ * @param cache_size: Capacity of the new server's cache, in documents, or
+ *        in units of main->cache_bytes bytes when it is set.
  * 
  * @brief The load balancer will generate 1 or 3 replica labels and will place
  * them inside the hash ring. The neighbor servers will distribute SOME of the
  * documents to the added server. Before distributing the documents, these
- * servers should execute all the tasks in their queues.
+ * servers should execute all the tasks in their queues. With warm handoff,
+ * the cached documents among them are added to the cache of the new server.
  */
 void loader_add_server(load_balancer *main, int server_id, int cache_size);
 
@@ -68,25 +255,131 @@ void loader_add_server(load_balancer *main, int server_id, int cache_size);
  * server to the "neighboring" servers.
  * 
  * Additionally, all the tasks stored in the removed server's queue
- * should be executed before moving the documents.
+ * should be executed before moving the documents. With warm handoff, the
+ * cached documents are added to the caches of their new servers.
  */
 void loader_remove_server(load_balancer *main, int server_id);
 
+/**
+ * loader_print_distribution() - Prints how the documents are spread.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param out: File where the report is written.
+ * 
+ * @brief The function will print the number of documents stored on each
+ * server, followed by the minimum, maximum and average number of documents
+ * per server.
+ */
+void loader_print_distribution(load_balancer *main, FILE *out);
+
+/**
+ * loader_print_memory() - Prints the occupancy of the servers' arenas.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param out: File where the report is written.
+ */
+void loader_print_memory(load_balancer *main, FILE *out);
+
+/**
+ * loader_print_handoff() - Prints how the hit rate of the caches recovers
+ * after the topology changes.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param out: File where the report is written.
+ * 
+ * @brief The function will print the number of topology changes and of
+ * cache entries handed over, then the hit rate of all the GETs and the one
+ * of the first HANDOFF_WINDOW GETs after every change.
+ */
+void loader_print_handoff(load_balancer *main, FILE *out);
+
+/**
+ * loader_print_latency() - Prints the percentiles of the recorded latencies.
+ * 
+ * @param main: Load balancer which distributes the work, synced.
+ * @param out: File where the report is written.
+ */
+void loader_print_latency(load_balancer *main, FILE *out);
+
+/**
+ * loader_print_stats() - Prints the counters of every server and the
+ * totals of the cluster.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param out: File where the report is written.
+ * 
+ * @brief The counters are kept as the requests are handled, so only the
+ * ring is walked, not the caches, queues or databases. The totals include
+ * the servers which were removed.
+ */
+void loader_print_stats(load_balancer *main, FILE *out);
+
+/**
+ * loader_handle_stats() - Handles a STATS request.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * 
+ * @brief The report of loader_print_stats is printed as the response of
+ * the request, after the responses of the requests before it (the shards
+ * are synced first), like any other response.
+ */
+void loader_handle_stats(load_balancer *main);
+
 /**
  * loader_forward_request() - Forwards a request to the appropriate server.
  * 
  * @param main: Load balancer which distributes the work.
  * @param req: Request to be forwarded (relevant fields from the request are
- *        dynamically allocated, but the caller have to free them).
+ *        dynamically allocated; the fields of a queued EDIT are taken over
+ *        and cleared, the caller has to free the ones left).
  * 
  * @return response* - Contains the response received from the server
  * 
  * @brief The load balancer will find the server which should handle the
- * request and will send the request to that server. The request will contain
+ * request, by binary searching the hash of the document on the hash ring,
+ * and will send the request to that server. The request will contain
  * the document name and/or content, which are dynamically allocated in main
  * and should be freed either here, either in server_handle_request, after
- * using them.
+ * using them. With shards, the request is sent to the shard of its server,
+ * which takes the strings of an EDIT, and NULL is returned: the response is
+ * printed by loader_sync.
  */
 response *loader_forward_request(load_balancer *main, request *req);
 
+/**
+ * loader_forward_hashed() - Forwards a request whose document was already
+ * hashed, like loader_forward_request.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param req: Request to be forwarded.
+ * @param hash: Hash of the document's name, computed with
+ *        main->hash_function_docs (e.g. stored in a compiled trace).
+ * 
+ * @return response* - Contains the response received from the server
+ */
+response *loader_forward_hashed(load_balancer *main, request *req,
+								unsigned int hash);
+
+/**
+ * loader_forward_batch() - Forwards a batch of requests, grouped by the
+ * servers handling them, then prints their responses in their order.
+ * 
+ * @param main: Load balancer which distributes the work.
+ * @param reqs: Requests to be forwarded, GETs and EDITs only; the strings
+ *        of the queued EDITs are taken over and cleared, like in
+ *        loader_forward_request.
+ * @param hashes: Hashes of the documents' names, computed with
+ *        main->hash_function_docs, or NULL to compute them here.
+ * @param n: Number of requests.
+ * 
+ * @brief All the requests are routed first, then every server handles its
+ * requests at once, in their order, so its cache, queue and database stay
+ * warm between them. The servers are independent, so the responses are the
+ * same as when the requests are forwarded one by one; they are kept in
+ * memory and printed in the order of the requests. With shards, the
+ * requests are simply forwarded one by one.
+ */
+void loader_forward_batch(load_balancer *main, request *reqs,
+						  const unsigned int *hashes, unsigned int n);
+
 #endif /* LOAD_BALANCER_H */
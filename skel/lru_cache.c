@@ -6,24 +6,100 @@
 
 lru_cache *init_lru_cache(unsigned int cache_capacity)
 {
-	// Check if the cache capacity is valid
-	if (cache_capacity == 0)
+	return init_lru_cache_arena(cache_capacity, NULL);
+}
+
+lru_cache *init_lru_cache_arena(unsigned int cache_capacity, arena_t *arena)
+{
+	return init_lru_cache_policy(cache_capacity, arena, &policy_lru);
+}
+
+lru_cache *init_lru_cache_policy(unsigned int cache_capacity, arena_t *arena,
+								 const cache_policy *policy)
+{
+	// Check if the cache capacity and the policy are valid
+	if (cache_capacity == 0 || !policy)
 		return NULL;
 
 	// Declare and allocate memory for the cache
 	lru_cache *cache = malloc(sizeof(*cache));
 	DIE(!cache, "malloc cache");
 
-	// Initialize the cache's hashtable
-	cache->ht = ht_create(cache_capacity, hash_string, compare_strings);
-
-	// Initialize the cache's linked list
-	cache->order = ll_create(sizeof(void *));
+	// Initialize the cache's index; it only references the keys and nodes
+	// of the linked list
+	cache->ht = oht_create_index(cache_capacity, hash_string);
+
+	// Initialize the cache's policy, which orders the nodes
+	cache->policy = policy;
+	cache->state = policy->create(cache_capacity, arena);
+
+	// Set the cache's capacity and allocator
+	cache->size = 0;
+	cache->capacity = cache_capacity;
+	cache->policy_capacity = cache_capacity;
+	cache->bytes = 0;
+	cache->byte_capacity = 0;
+	cache->evicted_key = NULL;
+	cache->evicted_num = 0;
+	cache->evicted_list = NULL;
+	cache->evicted_list_capacity = 0;
+	cache->arena = arena;
+	memset(&cache->stats, 0, sizeof(cache->stats));
 
 	// Return the cache
 	return cache;
 }
 
+/*
+ * resize_policy() - Sizes the policy for a number of key-value pairs.
+ */
+static void resize_policy(lru_cache *cache, unsigned int capacity)
+{
+	cache->policy_capacity = capacity;
+	if (cache->policy->resize)
+		cache->policy->resize(cache->state, capacity);
+}
+
+/*
+ * fit_policy() - With a byte budget, resizes the policy when the number of
+ * key-value pairs of the average size which fit in the budget is more than a
+ * quarter away from the one it is sized for; the margin keeps the policy
+ * from being resized by every put.
+ */
+static void fit_policy(lru_cache *cache)
+{
+	if (!cache->byte_capacity || !cache->bytes)
+		return;
+
+	unsigned long fit = cache->byte_capacity * cache->size / cache->bytes;
+	fit = fit < 1 ? 1 : fit > UINT_MAX ? UINT_MAX : fit;
+
+	unsigned long sized = cache->policy_capacity;
+	if (4 * fit < 3 * sized || 4 * fit > 5 * sized)
+		resize_policy(cache, fit);
+}
+
+void lru_cache_set_byte_capacity(lru_cache *cache, unsigned long byte_capacity)
+{
+	if (!cache)
+		return;
+
+	// Without a budget, the policy is sized for the capacity again
+	cache->byte_capacity = byte_capacity;
+	if (!byte_capacity && cache->policy_capacity != cache->capacity)
+		resize_policy(cache, cache->capacity);
+	fit_policy(cache);
+}
+
+bool lru_cache_has_key(lru_cache *cache, void *key)
+{
+	// Check if the cache and key are valid
+	if (!cache || !key)
+		return false;
+
+	return oht_has_key(cache->ht, key) == 1;
+}
+
 bool lru_cache_is_full(lru_cache *cache)
 {
 	// Check if the cache is valid
@@ -31,7 +107,131 @@ bool lru_cache_is_full(lru_cache *cache)
 		return false;
 
 	// Check if the cache is full
-	return cache->ht->hmax == cache->ht->size;
+	if (cache->byte_capacity)
+		return cache->bytes >= cache->byte_capacity;
+
+	return cache->size == cache->capacity;
+}
+
+ll_node_t *lru_cache_next(lru_cache *cache, ll_node_t *node)
+{
+	return cache->policy->next(cache->state, node);
+}
+
+/*
+ * free_string() - Gives a key back to the cache's allocator.
+ */
+static void free_string(lru_cache *cache, char *str)
+{
+	if (str)
+		arena_free(cache->arena, str, strlen(str) + 1);
+}
+
+/*
+ * dup_string() - Copies a key with the cache's allocator.
+ */
+static char *dup_string(lru_cache *cache, char *str)
+{
+	return arena_memdup(cache->arena, str, strlen(str) + 1);
+}
+
+/*
+ * alloc_entry() - Allocates the data of a node, of the size the policy needs.
+ */
+static info_t *alloc_entry(lru_cache *cache)
+{
+	// The plain key-value pairs have a pool of their own
+	if (cache->policy->entry_size == sizeof(info_t))
+		return arena_alloc_info(cache->arena);
+
+	return arena_alloc(cache->arena, cache->policy->entry_size);
+}
+
+/*
+ * free_entry() - Gives the data of a node back to the cache's allocator.
+ */
+static void free_entry(lru_cache *cache, info_t *entry)
+{
+	if (cache->policy->entry_size == sizeof(info_t))
+		arena_free_info(cache->arena, entry);
+	else
+		arena_free(cache->arena, entry, cache->policy->entry_size);
+}
+
+/*
+ * entry_bytes() - Gets the bytes a key-value pair takes from a byte budget.
+ */
+static unsigned long entry_bytes(char *key, char *value)
+{
+	return strlen(key) + blob_length(value);
+}
+
+/*
+ * needs_room() - Checks if a key has to be evicted before adding a key-value
+ * pair of the given size.
+ */
+static bool needs_room(lru_cache *cache, unsigned long bytes)
+{
+	if (!cache->size)
+		return false;
+
+	if (cache->byte_capacity)
+		return cache->bytes + bytes > cache->byte_capacity;
+
+	return cache->size == cache->capacity;
+}
+
+/*
+ * record_eviction() - Keeps an evicted key until the next put. The first one
+ * is kept as it is; when there are more of them, they are all listed in
+ * evicted_list, and the ones after the first are freed right away.
+ */
+static void record_eviction(lru_cache *cache, char *key)
+{
+	cache->stats.evictions++;
+
+	if (!cache->evicted_num++) {
+		cache->evicted_key = key;
+		return;
+	}
+
+	// The list starts with the first key, and gets every new one after a
+	// comma
+	const char *first = cache->evicted_num == 2 ? cache->evicted_key : NULL;
+	size_t used = first ? 0 : strlen(cache->evicted_list);
+	size_t needed = used + (first ? strlen(first) : 0) + strlen(key) + 3;
+
+	if (needed > cache->evicted_list_capacity) {
+		cache->evicted_list_capacity = needed * 2;
+		cache->evicted_list = realloc(cache->evicted_list,
+									  cache->evicted_list_capacity);
+		DIE(!cache->evicted_list, "realloc evicted list");
+	}
+
+	if (first)
+		used = sprintf(cache->evicted_list, "%s", first);
+	sprintf(cache->evicted_list + used, ", %s", key);
+
+	free_string(cache, key);
+}
+
+/*
+ * evict_node() - Removes the node the policy evicted from the index, keeps its
+ * key and drops its value; the node itself is left to the caller.
+ */
+static void evict_node(lru_cache *cache, ll_node_t *node)
+{
+	info_t *info = (info_t *)node->data;
+
+	oht_remove_entry(cache->ht, info->key);
+	cache->size--;
+	cache->bytes -= entry_bytes(info->key, info->value);
+
+	record_eviction(cache, info->key);
+	info->key = NULL;
+
+	blob_put(info->value);
+	info->value = NULL;
 }
 
 void free_lru_cache(lru_cache **cache)
@@ -40,65 +240,144 @@ void free_lru_cache(lru_cache **cache)
 	if (!*cache)
 		return;
 
-	// Free the cache's hashtable and linked list
-	ht_free((*cache)->ht);
-	ll_free_info(&(*cache)->order);
+	// Free the cache's index
+	oht_free((*cache)->ht);
+
+	// Drop the references to the values; the nodes allocated from an arena
+	// are released with the arena, the other ones are freed here
+	ll_node_t *next;
+	for (ll_node_t *node = lru_cache_next(*cache, NULL); node; node = next) {
+		next = lru_cache_next(*cache, node);
+		blob_put(((info_t *)node->data)->value);
+
+		if (!(*cache)->arena) {
+			free(((info_t *)node->data)->key);
+			free(node->data);
+			free(node);
+		}
+	}
+
+	if (!(*cache)->arena)
+		free((*cache)->evicted_key);
+	free((*cache)->evicted_list);
+
+	// Free the policy's lists, which are empty or released with the arena
+	(*cache)->policy->destroy((*cache)->state);
 
 	// Free the cache
 	free(*cache);
 	*cache = NULL;
 }
 
+/*
+ * make_room_for_update() - Evicts other keys until the cache is back within
+ * its budget, after the content of a key grew.
+ *
+ * @brief The node of the key is taken out of the policy while the others
+ * are evicted, so it cannot be picked, then put back where it was; it is not
+ * admitted again, since the key is not new to the policy.
+ */
+static void make_room_for_update(lru_cache *cache, ll_node_t *node)
+{
+	cache->policy->remove(cache->state, node);
+
+	while (cache->size > 1 && cache->bytes > cache->byte_capacity) {
+		ll_node_t *victim = cache->policy->evict(cache->state);
+		evict_node(cache, victim);
+
+		free_entry(cache, victim->data);
+		arena_free_node(cache->arena, victim);
+	}
+
+	cache->policy->insert(cache->state, node);
+}
+
+/*
+ * report_evictions() - Gives the key evicted by a put, or the list of them,
+ * to its caller.
+ */
+static void report_evictions(lru_cache *cache, void **evicted_key)
+{
+	if (evicted_key && cache->evicted_num)
+		*evicted_key = cache->evicted_num == 1 ? cache->evicted_key :
+												 cache->evicted_list;
+}
+
 bool lru_cache_put(lru_cache *cache, void *key, void *value, void **evicted_key)
 {
 	// Check if the cache, key and value are valid
 	if (!cache || !key || !value)
 		return false;
 
-	// Update existing key's value and move it to the end of the linked list
-	if (ht_has_key(cache->ht, key)) {
-		ll_node_t *node = move_node_to_end(cache->order, key);
-
-		// Update the value for the key
-		free(((info_t *)node->data)->value);
-		((info_t *)node->data)->value = strdup(value);
-
-		// Modify the key-value pair in the hashtable
-		ht_put(cache->ht, key, sizeof(key), node, sizeof(node));
+	// Free the key evicted by the previous put
+	free_string(cache, cache->evicted_key);
+	cache->evicted_key = NULL;
+	cache->evicted_num = 0;
+
+	// Update existing key's value, which counts as a use for the policy
+	ll_node_t *node = oht_get(cache->ht, key);
+	if (node) {
+		cache->policy->hit(cache->state, node);
+
+		// Share the new value for the key, which may be the same blob
+		info_t *info = (info_t *)node->data;
+		cache->bytes = cache->bytes - blob_length(info->value) +
+					   blob_length(value);
+		blob_get(value);
+		blob_put(info->value);
+		info->value = value;
+
+		// A larger content may take the cache over its budget
+		if (cache->byte_capacity && cache->bytes > cache->byte_capacity)
+			make_room_for_update(cache, node);
+		report_evictions(cache, evicted_key);
+		fit_policy(cache);
 
 		// The key already exists in the cache
 		return false;
-	} else if (lru_cache_is_full(cache)) {
-		// Evict the least recently used key
-		ll_node_t *node = ll_remove_nth_node(cache->order, 0);
-
-		// Store the evicted key
-		*evicted_key = strdup(((info_t *)node->data)->key);
-		ht_remove_entry(cache->ht, *evicted_key);
-
-		// Free the memory allocated for the evicted key and value
-		free(((info_t *)node->data)->key);
-		free(((info_t *)node->data)->value);
-		free(node->data);
-		free(node);
 	}
 
-	// Create a new info_t struct to store the key-value pair
-	info_t *info = malloc(sizeof(info_t));
-	info->key = strdup(key);
-	info->value = strdup(value);
+	// Let the policy see the new key, then evict as many keys as it takes
+	// to fit it; the node of the first evicted key is reused for the new one
+	unsigned long bytes = entry_bytes(key, value);
+	cache->policy->admit(cache->state, key);
+
+	node = NULL;
+	while (needs_room(cache, bytes)) {
+		ll_node_t *victim = cache->policy->evict(cache->state);
+		evict_node(cache, victim);
+
+		if (!node) {
+			node = victim;
+		} else {
+			free_entry(cache, victim->data);
+			arena_free_node(cache->arena, victim);
+		}
+	}
+
+	if (!node) {
+		node = arena_alloc_node(cache->arena);
+		node->data = alloc_entry(cache);
+	}
 
-	// Add the new node to the end of the linked list
-	ll_node_t *node =
-		ll_add_nth_node_info(cache->order, cache->order->size, info);
+	// Report the evicted key, or the list of them
+	report_evictions(cache, evicted_key);
 
-	// Free the temporary key and value strings
-	free(info->key);
-	free(info->value);
-	free(info);
+	// Store a copy of the key and a reference to the value in the node
+	info_t *info = (info_t *)node->data;
+	info->key = dup_string(cache, key);
+	info->value = blob_get(value);
 
-	// Add the key-value pair to the hashtable
-	ht_put(cache->ht, key, strlen(key) + 1, node, sizeof(node));
+	// Give the node to the policy
+	cache->policy->insert(cache->state, node);
+	cache->size++;
+	cache->bytes += bytes;
+
+	// Add the node to the index, under the key it owns
+	oht_put(cache->ht, info->key, strlen(info->key) + 1, node, sizeof(node));
+
+	// The average size of the pairs may have changed
+	fit_policy(cache);
 	return true;
 }
 
@@ -108,25 +387,20 @@ void *lru_cache_get(lru_cache *cache, void *key)
 	if (!cache || !key)
 		return NULL;
 
-	// Check if the key exists in the cache
-	if (!ht_has_key(cache->ht, key))
+	// Get the node corresponding to the key from the index
+	ll_node_t *node = oht_get(cache->ht, key);
+	if (!node) {
+		cache->stats.misses++;
 		return NULL;
+	}
+	cache->stats.hits++;
 
-	// Get the node corresponding to the key from the hashtable
-	ll_node_t *node = ht_get(cache->ht, key);
-
-	// Duplicate the value associated with the key
-	char *value = strdup(((info_t *)node->data)->value);
-
-	// Move the node to the end of the linked list to mark it as most recently used
-	ll_node_t *new_node = move_node_to_end(cache->order, key);
-
-	// Update the key-value pair in the hashtable
-	ht_remove_entry(cache->ht, key);
-	ht_put(cache->ht, key, strlen(key) + 1, new_node, sizeof(new_node));
+	// Mark the node as used; the policy only relinks it, so the index stays
+	// valid
+	cache->policy->hit(cache->state, node);
 
 	// Return the value associated with the key
-	return value;
+	return ((info_t *)node->data)->value;
 }
 
 void lru_cache_remove(lru_cache *cache, void *key)
@@ -135,22 +409,22 @@ void lru_cache_remove(lru_cache *cache, void *key)
 	if (!cache || !key)
 		return;
 
-	// Check if the key exists in the cache
-	if (!ht_has_key(cache->ht, key))
+	// Remove the key from the index, getting its node in the same lookup
+	ll_node_t *node = oht_detach_entry(cache->ht, key);
+	if (!node)
 		return;
 
-	// Remove the key from the linked list
-	ll_node_t *node = ll_get_node(cache->order, key);
-	ll_remove_node(cache->order, node);
-
-	// Remove the key from the hashtable
-	ht_remove_entry(cache->ht, key);
+	// Remove the node from the policy
+	cache->policy->remove(cache->state, node);
+	cache->size--;
+	cache->bytes -= entry_bytes(((info_t *)node->data)->key,
+								((info_t *)node->data)->value);
 
-	// Free the memory allocated for the key and value
-	free(((info_t *)node->data)->key);
-	free(((info_t *)node->data)->value);
+	// Free the key and drop the value
+	free_string(cache, ((info_t *)node->data)->key);
+	blob_put(((info_t *)node->data)->value);
 
 	// Free the memory allocated for the node
-	free(node->data);
-	free(node);
+	free_entry(cache, node->data);
+	arena_free_node(cache->arena, node);
 }
@@ -5,17 +5,61 @@
 #ifndef LRU_CACHE_H
 #define LRU_CACHE_H
 
+#include <limits.h>
 #include <stdbool.h>
 #include "utils.h"
-#include "add/hashtable.h"
-#include "add/specific_linked_list.h"
+#include "add/arena.h"
+#include "add/blob.h"
+#include "add/cache_policy.h"
+#include "add/open_hashtable.h"
 
+// Counters of the accesses to a cache
+typedef struct lru_stats {
+	// Gets which found their key and gets which did not
+	unsigned long hits, misses;
+
+	// Keys evicted to make room for new ones
+	unsigned long evictions;
+} lru_stats;
+
+// A cache of documents; despite its name, the keys it evicts are picked by
+// its replacement policy (see cache_policy.h), LRU unless another one is given
 typedef struct lru_cache {
-	// List of keys in the order they were accessed
-	ll_list_t *order;
+	// Replacement policy, which orders the nodes of the key-value pairs
+	// (info_t), and its state
+	const cache_policy *policy;
+	void *state;
+
+	// Index from each key to its node
+	open_hashtable_t *ht;
+
+	// Number of key-value pairs and maximum number of them; with a byte
+	// budget, the capacity is only the unit the budget was given in
+	unsigned int size;
+	unsigned int capacity;
+
+	// Number of key-value pairs the policy is sized for: the capacity, or
+	// with a byte budget, the number of pairs of the average size which fit
+	unsigned int policy_capacity;
 
-	// Hashtable to store the key-value pairs
-	hashtable_t *ht;
+	// Bytes of the keys and contents, and the most the cache may hold; 0
+	// when the cache is bounded by its number of key-value pairs
+	unsigned long bytes;
+	unsigned long byte_capacity;
+
+	// Key evicted by the last put and the number of keys it evicted; when
+	// there are more of them, they are all listed in evicted_list, separated
+	// by commas. They are kept until the next put.
+	void *evicted_key;
+	unsigned int evicted_num;
+	char *evicted_list;
+	unsigned int evicted_list_capacity;
+
+	// Allocator for the nodes and keys; NULL to use malloc
+	arena_t *arena;
+
+	// Hits, misses and evictions since the cache was created
+	lru_stats stats;
 } lru_cache;
 
 /*
@@ -31,6 +75,71 @@ typedef struct lru_cache {
 */
 lru_cache *init_lru_cache(unsigned int cache_capacity);
 
+/*
+ * init_lru_cache_arena() - Initializes an LRU cache using an arena.
+ * 
+ * @param cache_capacity: The maximum number of key-value pairs that the cache can store.
+ * @param arena: The arena the nodes and keys are allocated from; they
+ * are released together with the arena, not by free_lru_cache.
+ * 
+ * @return lru_cache* - The initialized LRU cache.
+ */
+lru_cache *init_lru_cache_arena(unsigned int cache_capacity, arena_t *arena);
+
+/*
+ * init_lru_cache_policy() - Initializes a cache with a replacement policy.
+ * 
+ * @param cache_capacity: The maximum number of key-value pairs that the cache can store.
+ * @param arena: The arena the nodes and keys are allocated from, or NULL.
+ * @param policy: The replacement policy (e.g. &policy_lru, or one found
+ * with cache_policy_find).
+ * 
+ * @return lru_cache* - The initialized cache.
+ */
+lru_cache *init_lru_cache_policy(unsigned int cache_capacity, arena_t *arena,
+								 const cache_policy *policy);
+
+/*
+ * lru_cache_set_byte_capacity() - Bounds the cache by the bytes of its keys
+ * and contents (without their null bytes) instead of by its number of
+ * key-value pairs.
+ * 
+ * @param cache: The cache to be bounded.
+ * @param byte_capacity: The most bytes the cache may hold, or 0 to bound it by
+ * its capacity again.
+ * 
+ * @brief A new key evicts as many keys as it takes to fit; a document larger
+ * than the whole budget evicts all the others and is kept alone. A larger
+ * content for a cached key evicts other keys too (reported by the put like
+ * the ones evicted for a new key), but the key itself stays. The policy is
+ * sized for the number of key-value pairs of the average size cached so far
+ * which fit in the budget, and resized as that average changes.
+ */
+void lru_cache_set_byte_capacity(lru_cache *cache, unsigned long byte_capacity);
+
+/*
+ * lru_cache_has_key() - Checks if a key is in the cache.
+ * 
+ * @param cache: The cache to be checked.
+ * @param key: The key to look for.
+ * 
+ * @return bool - True if the key is in the cache, without marking it as
+ * recently used.
+ */
+bool lru_cache_has_key(lru_cache *cache, void *key);
+
+/*
+ * lru_cache_next() - Walks the key-value pairs of the cache.
+ * 
+ * @param cache: The cache to be walked.
+ * @param node: The current node, or NULL to get the first one.
+ * 
+ * @return ll_node_t* - The next node (whose data is an info_t), or NULL after
+ * the last one. The nodes come roughly from the first to the last one the
+ * policy would evict; for LRU, from the least to the most recently used.
+ */
+ll_node_t *lru_cache_next(lru_cache *cache, ll_node_t *node);
+
 /*
  * lru_cache_is_full() - Checks if the cache is full.
  * 
@@ -58,9 +167,15 @@ void free_lru_cache(lru_cache **cache);
  * 
  * @param cache: Cache where the key-value pair will be stored.
  * @param key: Key of the pair.
- * @param value: Value of the pair.
+ * @param value: Value of the pair, a blob (see blob.h) which the cache
+ *      takes a reference to, instead of copying it.
  * @param evicted_key: The function will RETURN via this parameter the
- *      key removed from cache if the cache was full.
+ *      key removed from cache if the cache was full, or the list of the
+ *      keys removed if there were more of them (see evicted_num); it is
+ *      owned by the cache and is valid until the next put. The new key is
+ *      always added; the policy only picks the keys it replaces, which may
+ *      be ones added recently. With a byte budget, an existing key whose
+ *      value grew may evict other keys too, which are reported the same way.
  * 
  * @return - true if the key was added to the cache,
  *      false if the key already existed.
@@ -74,8 +189,10 @@ bool lru_cache_put(lru_cache *cache, void *key, void *value,
  * @param cache: Cache where the key-value pair is stored.
  * @param key: Key of the pair.
  * 
- * @return - The value associated with the key,
- *      or NULL if the key is not found.
+ * @return - The value associated with the key, or NULL if the key is
+ *      not found. The cache only holds a reference to the value, so it is
+ *      valid until the key is updated or removed, unless the caller takes
+ *      a reference of its own with blob_get.
  */
 void *lru_cache_get(lru_cache *cache, void *key);
 
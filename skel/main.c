@@ -11,144 +11,311 @@
 #include "lru_cache.h"
 #include "utils.h"
 #include "constants.h"
+#include "add/reader.h"
+#include "add/trace.h"
+#include "add/pipeline.h"
 
-void read_quoted_string(char *buffer, int buffer_len, int *start, int *end) {
-    *end = -1;
+/* Forwards a request, by the hash of its name if a trace stored it */
+response *forward_request(load_balancer *main, request *server_request,
+                          parsed_request *req) {
+    if (req->hashed)
+        return loader_forward_hashed(main, server_request, req->doc_hash);
 
-    for (int i = 0; i < buffer_len && buffer[i] != '\0'; ++i) {
-        if (buffer[i] != '"')
-            continue;
+    return loader_forward_request(main, server_request);
+}
+
+/* Handles the requests one by one, printing their responses */
+void handle_requests(load_balancer *main, reader_t *input, int requests_num) {
+    parsed_request req;
+
+    for (int i = 0; i < requests_num; i++) {
+        DIE(!reader_next(input, &req), "insufficient requests");
+
+        if (req.type == ADD_SERVER) {
+            DIE(req.cache_size < 0, "cache size must be positive");
+            loader_add_server(main, req.server_id,
+                              (unsigned int) req.cache_size);
+        } else if (req.type == REMOVE_SERVER) {
+            loader_remove_server(main, req.server_id);
+        } else if (req.type == GET_STATS) {
+            loader_handle_stats(main);
+        } else if (req.type == GET_DOCUMENT) {
+            /* A GET only reads its name, straight from the input file */
+            request server_request = {
+                .type = req.type,
+                .doc_name = req.doc_name,
+            };
 
-        if (*start == -1) {
-            *start = i;
+            response *response = forward_request(main, &server_request, &req);
+            PRINT_RESPONSE(response);
         } else {
-            *end = i;
-            break;
+            /* An EDIT is queued, so its strings get copies of their own,
+             * which are handed over to the server as they are */
+            request server_request = {
+                .type = req.type,
+                .doc_name = strndup(req.doc_name, req.doc_name_length),
+                .doc_content = blob_create(req.doc_content,
+                                           req.doc_content_length),
+            };
+            DIE(server_request.doc_name == NULL, "strndup failed");
+
+            response *response = forward_request(main, &server_request, &req);
+
+            /* The response borrows the name, so it is printed first */
+            PRINT_RESPONSE(response);
+
+            /* A queued EDIT took its strings, which were cleared here */
+            free(server_request.doc_name);
+            blob_put(server_request.doc_content);
         }
     }
 }
 
-request_type read_request_arguments(FILE *input_file, char *buffer,
-    int *maybe_server_id, int *maybe_cache_size,
-    char **maybe_doc_name, char **maybe_doc_content)
-{
-    request_type req_type;
-    int word_start = -1;
-    int word_end = -1;
-
-    DIE(fgets(buffer, REQUEST_LENGTH + 1, input_file) == NULL,
-        "insufficient requests");
-
-    req_type = get_request_type(buffer);
-
-    if (req_type == ADD_SERVER) {
-        *maybe_server_id = atoi(buffer + strlen(ADD_SERVER_REQUEST) + 1);
-        *maybe_cache_size = atoi(strchr(
-            buffer + strlen(ADD_SERVER_REQUEST) + 1, ' '));
-    } else if (req_type == REMOVE_SERVER) {
-        *maybe_server_id = atoi(buffer + strlen(REMOVE_SERVER_REQUEST) + 1);
-    } else {
-        *maybe_doc_name = calloc(1, DOC_NAME_LENGTH + 1);
-        DIE(*maybe_doc_name == NULL, "calloc failed");
-
-        read_quoted_string(buffer, REQUEST_LENGTH, &word_start, &word_end);
-        memcpy(*maybe_doc_name, buffer + word_start + 1,
-            word_end - word_start - 1);
-
-        if (req_type == EDIT_DOCUMENT) {
-            char *tmp_buffer = buffer + word_end + 1;
-
-            *maybe_doc_content = calloc(1, DOC_CONTENT_LENGTH + 1);
-            DIE(*maybe_doc_content == NULL, "calloc failed");
-
-            /* Read the content, which might be a multiline quoted string */
-            word_start = -1;
-            read_quoted_string(tmp_buffer, DOC_CONTENT_LENGTH,
-                &word_start, &word_end);
-
-            if (word_end == -1)
-                strcpy(*maybe_doc_content, tmp_buffer + word_start + 1);
-            else
-                strncpy(*maybe_doc_content, tmp_buffer + word_start + 1,
-                    word_end - word_start - 1);
-
-            while (word_end == -1) {
-                DIE(fgets(buffer, DOC_CONTENT_LENGTH + 1, input_file) == NULL,
-                    "document content is not properly quoted");
-
-                read_quoted_string(buffer, DOC_CONTENT_LENGTH,
-                    &word_start, &word_end);
-                memcpy(*maybe_doc_content + strlen(*maybe_doc_content), buffer,
-                    word_end == -1 ? strlen(buffer) : (unsigned) word_end);
-            }
-        } else {
-            *maybe_doc_content = NULL;
+/* Forwards the batched requests at once, then frees the strings left */
+void flush_batch(load_balancer *main, request *batch, unsigned int *hashes,
+                 unsigned int *batched) {
+    loader_forward_batch(main, batch, hashes, *batched);
+
+    /* The queued EDITs took their strings, which were cleared here */
+    for (unsigned int i = 0; i < *batched; i++) {
+        if (batch[i].type == EDIT_DOCUMENT) {
+            free(batch[i].doc_name);
+            blob_put(batch[i].doc_content);
         }
     }
 
-    return req_type;
+    *batched = 0;
 }
 
-void apply_requests(FILE  *input_file, char *buffer,
-                    int requests_num, bool enable_vnodes) {
-    char *doc_name, *doc_content;
-    int server_id, cache_size;
+/* Handles the requests in batches of up to batch_size GETs and EDITs,
+ * which are cut short by the topology changes */
+void handle_batches(load_balancer *main, reader_t *input, int requests_num,
+                    unsigned int batch_size) {
+    parsed_request req;
+    unsigned int batched = 0;
+    bool hashed = false;
 
-    load_balancer *main = init_load_balancer(enable_vnodes);
+    request *batch = malloc(batch_size * sizeof(*batch));
+    unsigned int *hashes = malloc(batch_size * sizeof(*hashes));
+    DIE(batch == NULL || hashes == NULL, "malloc batch");
 
     for (int i = 0; i < requests_num; i++) {
-        request_type req_type = read_request_arguments(input_file, buffer,
-            &server_id, &cache_size, &doc_name, &doc_content);
-
-        if (req_type == ADD_SERVER) {
-            DIE(cache_size < 0, "cache size must be positive");
-            loader_add_server(main, server_id, (unsigned int) cache_size);
-        } else if (req_type == REMOVE_SERVER) {
-            loader_remove_server(main, server_id);
+        DIE(!reader_next(input, &req), "insufficient requests");
+
+        if (req.type == ADD_SERVER || req.type == REMOVE_SERVER ||
+            req.type == GET_STATS) {
+            /* The batch is handled on the old topology, and counted by
+             * the STATS requests after it */
+            flush_batch(main, batch, hashed ? hashes : NULL, &batched);
+
+            if (req.type == ADD_SERVER) {
+                DIE(req.cache_size < 0, "cache size must be positive");
+                loader_add_server(main, req.server_id,
+                                  (unsigned int) req.cache_size);
+            } else if (req.type == REMOVE_SERVER) {
+                loader_remove_server(main, req.server_id);
+            } else {
+                loader_handle_stats(main);
+            }
+            continue;
+        }
+
+        /* A GET reads its name straight from the input file, while an
+         * EDIT gets copies of its strings, like in handle_requests */
+        request *server_request = &batch[batched];
+        server_request->type = req.type;
+        if (req.type == GET_DOCUMENT) {
+            server_request->doc_name = req.doc_name;
+            server_request->doc_content = NULL;
         } else {
-            request server_request = {
-                .type = req_type,
-                .doc_name = doc_name,
-            };
+            server_request->doc_name = strndup(req.doc_name,
+                                               req.doc_name_length);
+            server_request->doc_content = blob_create(req.doc_content,
+                                                      req.doc_content_length);
+            DIE(server_request->doc_name == NULL, "strndup failed");
+        }
 
-            if (req_type == EDIT_DOCUMENT) {
-                server_request.doc_content = doc_content;
-            }
+        /* A trace stores the hashes of all its names */
+        hashed = req.hashed;
+        hashes[batched++] = req.doc_hash;
 
-            response *response = loader_forward_request(main, &server_request);
+        if (batched == batch_size)
+            flush_batch(main, batch, hashed ? hashes : NULL, &batched);
+    }
 
-            free(server_request.doc_name);
-            free(server_request.doc_content);
+    flush_batch(main, batch, hashed ? hashes : NULL, &batched);
 
-            PRINT_RESPONSE(response);
+    free(batch);
+    free(hashes);
+}
+
+/* The optional flags, given after the input file */
+struct options {
+    bool print_distribution;
+    bool print_memory;
+    bool write_combining;
+    bool warm_handoff;
+    bool print_handoff;
+    bool print_stats;
+    bool print_latency;
+
+    /* One in this many requests is timed, a power of two */
+    int latency_sample;
+
+    /* Where to compile the input file to, instead of handling it */
+    char *trace_path;
+
+    int shards_num;
+    bool pipeline;
+    bool print_pipeline;
+    int batch_size;
+
+    /* NULL for LRU */
+    const cache_policy *cache_policy;
+
+    /* 0 to bound the caches by their number of documents */
+    long cache_bytes;
+};
+
+void apply_requests(reader_t *input, int requests_num, bool enable_vnodes,
+                    const struct options *opts) {
+    load_balancer *main = init_load_balancer(enable_vnodes);
+    main->write_combining = opts->write_combining;
+    main->warm_handoff = opts->warm_handoff;
+    main->cache_policy = opts->cache_policy;
+    main->cache_bytes = (unsigned long) opts->cache_bytes;
+    loader_enable_shards(main, (unsigned int) opts->shards_num);
+    if (opts->print_latency)
+        loader_enable_latency(main, (unsigned int) opts->latency_sample);
+
+    /* Parse, handle and print the requests on three threads instead */
+    if (opts->pipeline)
+        pipeline_run(main, input, requests_num,
+                     opts->print_pipeline ? stderr : NULL);
+    else if (opts->batch_size)
+        handle_batches(main, input, requests_num,
+                       (unsigned int) opts->batch_size);
+    else
+        handle_requests(main, input, requests_num);
+
+    /* Print the responses still kept by the shards */
+    loader_sync(main);
+
+    if (opts->print_distribution)
+        loader_print_distribution(main, stderr);
+
+    if (opts->print_memory)
+        loader_print_memory(main, stderr);
+
+    if (opts->print_handoff)
+        loader_print_handoff(main, stderr);
+
+    if (opts->print_stats)
+        loader_print_stats(main, stderr);
+
+    if (opts->print_latency)
+        loader_print_latency(main, stderr);
+
+    free_load_balancer(&main);
+}
+
+/* Parses the optional flags, given after the input file */
+void parse_options(int argc, char **argv, struct options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->latency_sample = LATENCY_SAMPLE_DEFAULT;
+
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--distribution"))
+            opts->print_distribution = true;
+        else if (!strcmp(argv[i], "--memory"))
+            opts->print_memory = true;
+        else if (!strcmp(argv[i], "--write-combining"))
+            opts->write_combining = true;
+        else if (!strcmp(argv[i], "--warm-handoff"))
+            opts->warm_handoff = true;
+        else if (!strcmp(argv[i], "--handoff-stats"))
+            opts->print_handoff = true;
+        else if (!strcmp(argv[i], "--stats"))
+            opts->print_stats = true;
+        else if (!strcmp(argv[i], "--latency"))
+            opts->print_latency = true;
+        else if (!strncmp(argv[i], "--latency=", 10)) {
+            opts->print_latency = true;
+            opts->latency_sample = atoi(argv[i] + 10);
         }
+        else if (!strncmp(argv[i], "--compile-trace=", 16))
+            opts->trace_path = argv[i] + 16;
+        else if (!strncmp(argv[i], "--shards=", 9))
+            opts->shards_num = atoi(argv[i] + 9);
+        else if (!strcmp(argv[i], "--pipeline"))
+            opts->pipeline = true;
+        else if (!strcmp(argv[i], "--pipeline-stats"))
+            opts->pipeline = opts->print_pipeline = true;
+        else if (!strncmp(argv[i], "--batch=", 8))
+            opts->batch_size = atoi(argv[i] + 8);
+        else if (!strncmp(argv[i], "--cache-policy=", 15)) {
+            opts->cache_policy = cache_policy_find(argv[i] + 15);
+            DIE(opts->cache_policy == NULL, "unknown cache policy");
+        } else if (!strncmp(argv[i], "--cache-bytes=", 14))
+            opts->cache_bytes = atol(argv[i] + 14);
+        else
+            DIE(1, "unknown option");
     }
 
-    free_load_balancer(&main);
+    DIE(opts->latency_sample <= 0 ||
+        (opts->latency_sample & (opts->latency_sample - 1)),
+        "the latency sample must be a power of two");
+    DIE(opts->shards_num < 0, "the number of shards must be positive");
+    DIE(opts->pipeline && opts->shards_num,
+        "the pipeline runs without shards");
+    DIE(opts->batch_size < 0, "the size of a batch must be positive");
+    DIE(opts->pipeline && opts->batch_size,
+        "the pipeline cannot batch requests");
+    DIE(opts->cache_bytes < 0, "the bytes of a cache unit must be positive");
 }
 
 int main(int argc, char **argv) {
-    FILE *input;
+    reader_t *input;
     int requests_num;
     bool enable_vnodes;
-
-    char buffer[REQUEST_LENGTH + 1];
+    struct options opts;
 
     if (argc < 2) {
-        printf("Usage: %s <input_file>\n", argv[0]);
+        printf("Usage: %s <input_file> [--distribution] [--memory] "
+               "[--write-combining] [--warm-handoff] [--handoff-stats] "
+               "[--stats] [--latency[=<sample>]] "
+               "[--compile-trace=<trace_file>] "
+               "[--shards=<threads>] [--pipeline] [--pipeline-stats] "
+               "[--batch=<requests>] "
+               "[--cache-policy=lru|clock|2q|arc|tinylfu] "
+               "[--cache-bytes=<bytes>]\n",
+               argv[0]);
         return -1;
     }
 
-    input = fopen(argv[1], "rt");
+    parse_options(argc, argv, &opts);
+
+    /* The input file is mapped, so the requests are read without copies */
+    input = reader_open(argv[1]);
     DIE(input == NULL, "missing input file");
 
-    DIE(fgets(buffer, REQUEST_LENGTH + 1, input) == 0, "empty input file");
-    requests_num = atoi(buffer);
-    enable_vnodes = strstr(buffer, "ENABLE_VNODES");
+    reader_header(input, &requests_num, &enable_vnodes);
+
+    if (opts.trace_path) {
+        /* Compile the requests instead of handling them */
+        writer_t *trace = writer_open(opts.trace_path);
+        DIE(trace == NULL, "cannot create trace file");
+
+        trace_compile(input, requests_num, enable_vnodes, trace);
+        writer_close(&trace);
+    } else {
+        apply_requests(input, requests_num, enable_vnodes, &opts);
+    }
 
-    apply_requests(input, buffer, requests_num, enable_vnodes);
+    /* The responses are buffered until here */
+    writer_flush(writer_stdout());
 
-    fclose(input);
+    reader_close(&input);
 
     return 0;
 }
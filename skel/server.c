@@ -6,77 +6,89 @@
 #include "server.h"
 
 /**
- * @brief Edits a document in the server's cache and database.
+ * @brief Writes the content of a queued edit to the database, combining it
+ *     with the other edits of the document still in the queue.
  * 
- * @param s: The server.
- * @param doc_name: The name of the document.
- * @param doc_content: The content of the document.
+ * @param s: The server, with write combining enabled.
+ * @param task: The queued edit.
+ * @param last_content: The content of the last queued edit of the document.
  * 
- * @return response*: The response from the server.
+ * @return int: 1 if the edit creates the document, 0 otherwise.
  */
-static response *server_edit_document(server *s, char *doc_name,
-									  char *doc_content)
+static int server_combine_edit(server *s, request *task, char *last_content)
 {
-	// Check if the server, document name and content are valid
-	if (!s || !doc_name || !doc_content)
-		return NULL;
-
-	// Allocate memory for the response from the server
-	response *res = calloc(1, sizeof(*res));
-	DIE(!res, "calloc response");
-
-	// Allocate memory for the response
-	res->server_response = malloc(MAX_RESPONSE_LENGTH);
-	DIE(!res->server_response, "malloc response");
-
-	// Allocate memory for the log message
-	res->server_log = malloc(MAX_LOG_LENGTH);
-	DIE(!res->server_log, "malloc log");
-
-	// Set the server's id
-	res->server_id = s->id;
+	// The first edit of the document writes the last content to the
+	// database; the ones after it find it there and do not write again
+	int created = 0;
+	if (oht_get(s->db, task->doc_name) != last_content)
+		created = oht_put_owned(s->db, task->doc_name,
+								strlen(task->doc_name) + 1,
+								blob_get(last_content),
+								blob_length(last_content) + 1);
+
+	// The last edit of the document is no longer pending
+	if (task->doc_content == last_content)
+		oht_remove_entry(s->pending, task->doc_name);
+
+	return created;
+}
 
-	// Check if the document is in the cache
-	if (ht_has_key(s->cache->ht, doc_name)) {
-		// Get the corresponding response and log messages
-		sprintf(res->server_response, MSG_B, doc_name);
-		sprintf(res->server_log, LOG_HIT, doc_name);
+/**
+ * @brief Edits a document in the server's cache and database.
+ * 
+ * @param s: The server.
+ * @param task: The queued edit; its content (unless write combining is
+ *        enabled) and, for a new document, its name are handed over to the
+ *        database and cleared from the task.
+ * @param res: The response from the server, which borrows the name of the
+ *        document, so it should be printed before the task is dequeued.
+ */
+static void server_edit_document(server *s, request *task, response *res)
+{
 
-		// Update the document's content in the cache and the database
-		lru_cache_put(s->cache, doc_name, doc_content, NULL);
-		ht_put(s->db, doc_name, strlen(doc_name) + 1, doc_content,
-			   strlen(doc_content) + 1);
+	char *doc_name = task->doc_name;
+	char *doc_content = task->doc_content;
 
-		// Return the response
-		return res;
-	}
+	// Set the id of the label the server was reached through
+	res->server_id = s->label;
+	res->doc_name = doc_name;
 
-	// Save the evicted key and check if the cache is full
+	// Share the document's content with the cache and move the task's
+	// reference into the database; the content itself is never copied.
+	// When combining, the cache still gets the content of every edit, so
+	// its evictions (which depend on the sizes with a byte budget) are the
+	// same as when the edits are applied one by one.
 	void *evicted_key = NULL;
-	bool full = lru_cache_is_full(s->cache);
-
-	// Check if the document is in the database and get a corresponding response
-	if (ht_has_key(s->db, doc_name)) {
-		sprintf(res->server_response, MSG_B, doc_name);
+	bool added = lru_cache_put(s->cache, doc_name, doc_content, &evicted_key);
+	int created;
+	if (s->pending) {
+		created = server_combine_edit(s, task,
+									  oht_get(s->pending, doc_name));
 	} else {
-		sprintf(res->server_response, MSG_C, doc_name);
+		created = oht_put_owned(s->db, doc_name, strlen(doc_name) + 1,
+								doc_content, blob_length(doc_content) + 1);
+		task->doc_content = NULL;
 	}
 
-	// Update the document's content in the cache and the database
-	lru_cache_put(s->cache, doc_name, doc_content, &evicted_key);
-	ht_put(s->db, doc_name, strlen(doc_name) + 1, doc_content,
-		   strlen(doc_content) + 1);
-
-	// Get the corresponding log message
-	if (full) {
-		sprintf(res->server_log, LOG_EVICT, doc_name, (char *)evicted_key);
+	// A created document keeps the name of the task as its key
+	if (created)
+		task->doc_name = NULL;
+
+	// Get the response corresponding to whether the document existed before
+	res->msg = created ? RESPONSE_MSG_C : RESPONSE_MSG_B;
+
+	// Get the log message corresponding to the cache access; the evicted
+	// key is owned by the cache. A hit only evicts keys when the new content
+	// takes the cache over its byte budget.
+	if (evicted_key) {
+		res->log = added ? RESPONSE_LOG_EVICT : RESPONSE_LOG_HIT_EVICT;
+		res->evicted_key = evicted_key;
+		res->evicted_num = s->cache->evicted_num;
+	} else if (!added) {
+		res->log = RESPONSE_LOG_HIT;
 	} else {
-		sprintf(res->server_log, LOG_MISS, doc_name);
+		res->log = RESPONSE_LOG_MISS;
 	}
-
-	// Free the evicted key and return the response
-	free(evicted_key);
-	return res;
 }
 
 /**
@@ -84,81 +96,65 @@ static response *server_edit_document(server *s, char *doc_name,
  * 
  * @param s: The server.
  * @param doc_name: The name of the document.
- * 
- * @return response*: The response from the server.
+ * @param res: The response from the server, whose message is the content
+ *        of the document, borrowed from the cache.
  */
-static response *server_get_document(server *s, char *doc_name)
+static void server_get_document(server *s, char *doc_name, response *res)
 {
-	// Check if the server and document name are valid
-	if (!s || !doc_name)
-		return NULL;
-
-	// Allocate memory for the response from the server
-	response *res = calloc(1, sizeof(*res));
-	DIE(!res, "calloc response");
-
-	// Allocate memory for the response
-	res->server_response = malloc(MAX_RESPONSE_LENGTH);
-	DIE(!res->server_response, "malloc response");
-
-	// Allocate memory for the log message
-	res->server_log = malloc(MAX_LOG_LENGTH);
-	DIE(!res->server_log, "malloc log");
+	// Set the id of the label the server was reached through
+	res->server_id = s->label;
+	res->doc_name = doc_name;
 
-	// Set the server's id
-	res->server_id = s->id;
+	// Get the document's content from the cache
+	char *doc_content = lru_cache_get(s->cache, doc_name);
 
 	// Check if the document is in the cache
-	if (ht_has_key(s->cache->ht, doc_name)) {
-		// Get the document's content from the cache
-		char *doc_content = lru_cache_get(s->cache, doc_name);
-
+	if (doc_content) {
 		// Get the corresponding response and log messages
-		strcpy(res->server_response, doc_content);
-		sprintf(res->server_log, LOG_HIT, doc_name);
-
-		// Free the document's content and return the response
-		free(doc_content);
-		return res;
+		res->msg = RESPONSE_CONTENT;
+		res->doc_content = doc_content;
+		res->log = RESPONSE_LOG_HIT;
+		return;
 	}
 
-	// Check if the document is in the database
-	if (!ht_has_key(s->db, doc_name)) {
-		// Get the corresponding response and log messages
-		free(res->server_response);
-		res->server_response = NULL;
-		sprintf(res->server_log, LOG_FAULT, doc_name);
+	// Get the document's content from the database
+	doc_content = oht_get(s->db, doc_name);
 
-		// Return the response
-		return res;
+	// Check if the document is in the database
+	if (!doc_content) {
+		// Get the corresponding log message; there is no response
+		res->log = RESPONSE_LOG_FAULT;
+		return;
 	}
 
-	// Save the evicted key and check if the cache is full
+	// Update the document's content in the cache, saving the evicted key
 	void *evicted_key = NULL;
-	bool full = lru_cache_is_full(s->cache);
-
-	// Get the document's content from the database
-	char *doc_content = strdup(ht_get(s->db, doc_name));
-
-	// Update the document's content in the cache
 	lru_cache_put(s->cache, doc_name, doc_content, &evicted_key);
 
 	// Get the corresponding response
-	strcpy(res->server_response, doc_content);
-
-	// Get the corresponding log message
-	if (full) {
-		sprintf(res->server_log, LOG_EVICT, doc_name, (char *)evicted_key);
+	res->msg = RESPONSE_CONTENT;
+	res->doc_content = doc_content;
+
+	// Get the corresponding log message; the evicted key is owned by the
+	// cache
+	if (evicted_key) {
+		res->log = RESPONSE_LOG_EVICT;
+		res->evicted_key = evicted_key;
+		res->evicted_num = s->cache->evicted_num;
 	} else {
-		sprintf(res->server_log, LOG_MISS, doc_name);
+		res->log = RESPONSE_LOG_MISS;
 	}
+}
 
-	// Free the document's content and evicted key
-	free(doc_content);
-	free(evicted_key);
-
-	// Return the response
-	return res;
+/**
+ * @brief Clears the response of the server, for a new request or task.
+ * 
+ * @return response*: The response, owned by the server.
+ */
+static response *reset_response(server *s)
+{
+	memset(&s->last_response, 0, sizeof(s->last_response));
+	return &s->last_response;
 }
 
 server *init_server(unsigned int cache_size)
@@ -171,36 +167,80 @@ server *init_server(unsigned int cache_size)
 	server *s = calloc(1, sizeof(*s));
 	DIE(!s, "calloc server");
 
-	// Initialize the server's fields
-	s->cache = init_lru_cache(cache_size);
-	s->tasks = q_create(sizeof(request), TASK_QUEUE_SIZE);
-	s->db = ht_create(cache_size * 2, hash_string, compare_strings);
+	// Initialize the server's fields; the cache and the database allocate
+	// their entries from the server's arena, and share the contents (blobs)
+	s->arena = arena_create();
+	s->cache = init_lru_cache_arena(cache_size, s->arena);
+	s->tasks = q_create(sizeof(request), TASK_QUEUE_INITIAL_CAPACITY);
+	s->db = oht_create(cache_size * 2, hash_string, blob_put, s->arena);
+
+	// Keep the documents sorted by their hashes too, for rebalancing
+	oht_enable_order(s->db);
+
+	// The responses of the tasks are printed right away
+	s->out = writer_stdout();
+	s->print = response_write;
 
 	// Return the server
 	return s;
 }
 
+void server_enable_write_combining(server *s)
+{
+	// Check if the server is valid and has no tasks yet
+	if (!s || !q_is_empty(s->tasks) || s->pending)
+		return;
+
+	// The index only references the names and contents of the queued tasks
+	s->pending = oht_create_index(TASK_QUEUE_INITIAL_CAPACITY, hash_string);
+}
+
+void server_set_cache_policy(server *s, const cache_policy *policy)
+{
+	// Check if the server is valid and its cache is still empty
+	if (!s || !policy || s->cache->size)
+		return;
+
+	unsigned int capacity = s->cache->capacity;
+	free_lru_cache(&s->cache);
+	s->cache = init_lru_cache_policy(capacity, s->arena, policy);
+}
+
+void server_set_cache_budget(server *s, unsigned long bytes)
+{
+	if (s)
+		lru_cache_set_byte_capacity(s->cache, bytes);
+}
+
 void execute_queue(server *s)
 {
 	// Check if the server is valid
 	if (!s)
 		return;
 
+	// Time the execution, unless there is nothing to execute
+	bool executing = !q_is_empty(s->tasks);
+	unsigned long start = executing ? latency_start(s->latency) : 0;
+
 	// Execute all the tasks in the queue
 	while (!q_is_empty(s->tasks)) {
 		// Get the first task from the queue
 		request *task = (request *)q_front(s->tasks);
 
 		// Execute the task and get the corresponding response
-		response *res =
-			server_edit_document(s, task->doc_name, task->doc_content);
+		response *res = reset_response(s);
+		server_edit_document(s, task, res);
 
-		// Print the response
-		PRINT_RESPONSE(res);
+		// Print the response while the task still has the name
+		s->print(s->out, res);
+		s->stats.tasks++;
 
 		// Remove the task from the queue
 		q_dequeue_request(s->tasks);
 	}
+
+	if (executing)
+		latency_record(s->latency, LATENCY_EXECUTE_QUEUE, start);
 }
 
 response *server_handle_request(server *s, request *req)
@@ -214,33 +254,45 @@ response *server_handle_request(server *s, request *req)
 		// Execute all the tasks in the queue
 		execute_queue(s);
 
-		// Edit the document and return the response
-		return server_get_document(s, req->doc_name);
+		// Get the document and return the response
+		response *res = reset_response(s);
+		server_get_document(s, req->doc_name, res);
+
+		s->stats.gets++;
+		s->stats.faults += res->log == RESPONSE_LOG_FAULT;
+		return res;
 	}
 
 	// Handle the edit document request
+	response *res = reset_response(s);
+
+	// Set the id of the label the server was reached through
+	res->server_id = s->label;
+
+	// Get the corresponding response; the name is borrowed from the queued
+	// task once the request is moved to the queue
+	res->msg = RESPONSE_MSG_A;
+	res->doc_name = req->doc_name;
+
+	// Make the request the last pending edit of its document; the index is
+	// keyed by the name of the request, which lives at least as long as
+	// the entry, since the entry is removed when the request is executed
+	if (s->pending) {
+		oht_remove_entry(s->pending, req->doc_name);
+		oht_put(s->pending, req->doc_name, strlen(req->doc_name) + 1,
+				req->doc_content, sizeof(req->doc_content));
+	}
 
-	// Add the request to the server's task queue
+	// Move the request to the server's task queue
 	q_enqueue_request(s->tasks, (void *)req);
 
-	// Allocate memory for the response from the server
-	response *res = calloc(1, sizeof(*res));
-	DIE(!res, "calloc response");
-
-	// Allocate memory for the response
-	res->server_response = malloc(MAX_RESPONSE_LENGTH);
-	DIE(!res->server_response, "malloc response");
-
-	// Allocate memory for the log message
-	res->server_log = malloc(MAX_LOG_LENGTH);
-	DIE(!res->server_log, "malloc log");
-
-	// Set the server's id
-	res->server_id = s->id;
+	// Get the corresponding log message
+	res->log = RESPONSE_LOG_LAZY_EXEC;
+	res->queue_size = s->tasks->size;
 
-	// Get the corresponding response and log messages
-	sprintf(res->server_response, MSG_A, "EDIT", req->doc_name);
-	sprintf(res->server_log, LOG_LAZY_EXEC, s->tasks->size);
+	s->stats.edits++;
+	if (s->tasks->size > s->stats.peak_queue)
+		s->stats.peak_queue = s->tasks->size;
 
 	// Return the response
 	return res;
@@ -255,7 +307,11 @@ void free_server(server **s)
 	// Free the server's fields
 	free_lru_cache(&(*s)->cache);
 	q_free_request((*s)->tasks);
-	ht_free((*s)->db);
+	oht_free((*s)->db);
+	oht_free((*s)->pending);
+
+	// Release the entries of the cache and the database at once
+	arena_destroy(&(*s)->arena);
 
 	// Free the server
 	free(*s);
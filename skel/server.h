@@ -8,15 +8,36 @@
 #include "constants.h"
 #include "lru_cache.h"
 #include "add/queue.h"
+#include "add/open_hashtable.h"
+#include "add/response.h"
+#include "add/latency.h"
 
-#define TASK_QUEUE_SIZE 1000
-#define MAX_LOG_LENGTH 1000
-#define MAX_RESPONSE_LENGTH 4096
+// Initial capacity of the task queue, which grows when needed
+#define TASK_QUEUE_INITIAL_CAPACITY 16
+
+// Counters of the work done by a server, kept as it handles its requests
+typedef struct server_stats {
+	// Requests handled, and the GETs of documents which do not exist
+	unsigned long gets, edits;
+	unsigned long faults;
+
+	// Queued edits executed, and the most tasks queued at once
+	unsigned long tasks;
+	unsigned int peak_queue;
+
+	// Documents taken over from and given to other servers when the
+	// topology changed
+	unsigned long migrated_in, migrated_out;
+} server_stats;
 
 typedef struct server {
 	// Server ID
 	int id;
 
+	// ID of the label (replica) the last request came through; it is the
+	// ID reported in the responses of the server
+	int label;
+
 	// Cache for the server
 	lru_cache *cache;
 
@@ -24,7 +45,32 @@ typedef struct server {
 	queue_t *tasks;
 
 	// Database for the server
-	hashtable_t *db;
+	open_hashtable_t *db;
+
+	// Index from every document in the task queue to the content of its
+	// last queued edit; NULL unless write combining is enabled
+	open_hashtable_t *pending;
+
+	// Allocator for the entries of the cache and the database
+	arena_t *arena;
+
+	// Response to the last request, returned by server_handle_request
+	response last_response;
+
+	// Writer the responses of the executed tasks are printed to, and the
+	// way they are printed: response_write to the standard output, unless
+	// the server runs on a shard (in memory) or in a pipeline (packed)
+	writer_t *out;
+	void (*print)(writer_t *w, const response *res);
+
+	// Counters of the requests; the ones of the cache are in the cache, and
+	// the size of the database in the database
+	server_stats stats;
+
+	// Latencies the executions of non-empty task queues are recorded into,
+	// owned by the load balancer or by the server's shard; NULL when the
+	// latencies are not recorded
+	latency_t *latency;
 } server;
 
 typedef struct request {
@@ -38,17 +84,6 @@ typedef struct request {
 	char *doc_content;
 } request;
 
-typedef struct response {
-	// The log message
-	char *server_log;
-
-	// The response message
-	char *server_response;
-
-	// The server ID
-	int server_id;
-} response;
-
 /**
  * @brief Initializes a server with the given cache size.
  * 
@@ -58,6 +93,33 @@ typedef struct response {
  */
 server *init_server(unsigned int cache_size);
 
+/**
+ * @brief Enables write combining: the edits queued for the same document
+ *     write the database only once, with the last content, while still
+ *     producing the same responses as when they are applied one by one.
+ * 
+ * @param s: The server, whose task queue should be empty.
+ */
+void server_enable_write_combining(server *s);
+
+/**
+ * @brief Replaces the LRU cache of the server with one of the same capacity
+ *     using another replacement policy.
+ * 
+ * @param s: The server, whose cache should be empty.
+ * @param policy: The replacement policy.
+ */
+void server_set_cache_policy(server *s, const cache_policy *policy);
+
+/**
+ * @brief Bounds the cache of the server by the bytes of the names and
+ *     contents of its documents instead of by their number.
+ * 
+ * @param s: The server.
+ * @param bytes: The most bytes the cache may hold.
+ */
+void server_set_cache_budget(server *s, unsigned long bytes);
+
 /**
  * @brief Executes all the tasks in the server's queue.
  * 
@@ -80,7 +142,8 @@ void free_server(server **s);
  * @param req: Request to be processed.
  * 
  * @return response*: Response of the requested operation, which will
- *      then be printed in main.
+ *      then be printed in main; it is owned by the server and is only
+ *      valid until the server gets another request.
  * 
  * @brief Based on the type of request, should call the appropriate
  *     solver, and should execute the tasks from queue if needed (in
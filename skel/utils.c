@@ -37,6 +37,8 @@ char *get_request_type_str(request_type req_type) {
         return EDIT_REQUEST;
     case GET_DOCUMENT:
         return GET_REQUEST;
+    case GET_STATS:
+        return STATS_REQUEST;
     }
 
     return NULL;
@@ -57,6 +59,9 @@ request_type get_request_type(char *request_type_str) {
     else if (!strncmp(request_type_str,
                       GET_REQUEST, strlen(GET_REQUEST)))
         type = GET_DOCUMENT;
+    else if (!strncmp(request_type_str,
+                      STATS_REQUEST, strlen(STATS_REQUEST)))
+        type = GET_STATS;
     else
         DIE(1, "unknown request type");
 
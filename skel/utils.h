@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "constants.h"
+#include "add/writer.h"
 
 #define DIE(assertion, call_description)                                      \
     do {                                                                      \
@@ -22,13 +23,8 @@
     } while (0)
 
 #define PRINT_RESPONSE(response_ptr) ({                                       \
-    if (response_ptr) {                                                       \
-        printf(GENERIC_MSG, response_ptr->server_id,                          \
-            response_ptr->server_response, response_ptr->server_id,           \
-            response_ptr->server_log);                                        \
-        free(response_ptr->server_response);                                  \
-        free(response_ptr->server_log);                                       \
-        free(response_ptr);}                                                  \
+    if (response_ptr)                                                         \
+        response_write(writer_stdout(), response_ptr);                        \
     })
 
 